@@ -0,0 +1,349 @@
+#pragma once
+
+#include "Solver/Krylov.h"
+#include "Solver/CSR.h"
+#include "Solver/Preconditioner.h"
+#include "Solver/DenseInverse.h"
+#include "Common/Exception.h"
+#include <memory>
+#include <vector>
+
+namespace Solver {
+
+/*
+overlapping additive Schwarz domain decomposition preconditioner
+Smith, Bjorstad, Gropp "Domain Decomposition" 1996
+Cai, Sarkis (1999). "A Restricted Additive Schwarz Preconditioner for General Sparse Linear Systems." SIAM Journal on Scientific Computing vol. 21 no. 2
+
+MInv = sum_i R_i^T A_i^-1 R_i
+for the restricted variant (RAS), each subdomain only writes back the unknowns it owns
+
+each subdomain is an overlapping index set, with an owned subset that the subdomains partition between them
+local solves are either dense, LU-factoring the local block at setup,
+or iterative, using a Krylov solver created with the same factory signature JFNK uses
+a matrix-free A has its local blocks probed with one application of A per local unknown,
+while a CSR A has them read directly from its rows
+
+subdomain setup and solves are run across numThreads threads
+A is called from those threads when probing and for Krylov local solves, so it must be reentrant if numThreads > 1
+
+the optional coarse space is Nicolaides' piecewise constant space over the owned sets,
+added as a second additive level: MInv += Z (Z^T A Z)^-1 Z^T
+
+a Preconditioner: usable as Krylov::MInv via getMInv(), which references this object, or as JFNK's preconditioner.
+*/
+template<typename real>
+struct AdditiveSchwarz : public Preconditioner<real> {
+	using Func = typename Krylov<real>::Func;
+
+	//same signature as JFNK's createLinearSolver
+	using CreateSolver = std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, Func A)>;
+
+	AdditiveSchwarz(size_t n, Func A, bool restricted = true);
+
+	//A must stay alive as long as this object.  it is applied through getFunc() for the coarse space and Krylov local solves.
+	AdditiveSchwarz(const CSR<real>& A, bool restricted = true);
+
+	/*
+	adds a subdomain
+	indexes = the overlapping set of unknowns the local problem is solved on
+	owned = the subset of indexes this subdomain is responsible for.  owned sets should partition the unknowns.
+	createSolver = local Krylov solver factory, or empty to use a dense local inverse
+	*/
+	void addSubdomain(const std::vector<size_t>& indexes, const std::vector<size_t>& owned, CreateSolver createSolver = CreateSolver());
+
+	/*
+	splits [0,n) into numSubdomains contiguous owned ranges, each extended by overlap in both directions
+	*/
+	void addContiguousSubdomains(size_t numSubdomains, size_t overlap, CreateSolver createSolver = CreateSolver());
+
+	/*
+	builds the dense local factorizations and the coarse space
+	called automatically on the first apply, and must be called again if A changes
+	throws if a dense local block or the coarse space matrix is singular
+	*/
+	void setup();
+
+	//as JFNK's preconditioner A is the Jacobian at x, so every newton step rebuilds
+	virtual void setup(const real*, const real*) { setup(); }
+
+	//y = MInv(x).  y and x can be the same memory
+	void operator()(real* y, const real* x);
+
+	//same as operator()
+	virtual void apply(real* y, const real* r) { (*this)(y, r); }
+
+	//only write back each subdomain's owned unknowns
+	bool restricted;
+
+	//add the piecewise constant coarse space
+	bool useCoarseSpace;
+
+	//0 = Parallel default
+	size_t numThreads;
+
+protected:
+	size_t n;
+	Func A;
+	const CSR<real>* csr;	//if set, dense local blocks are read from it rather than probed through A
+	bool isSetup;
+
+	struct Subdomain {
+		std::vector<size_t> indexes;
+		std::vector<bool> isOwned;		//per element of indexes
+		std::vector<size_t> owned;
+		std::vector<real> x;			//local solution
+		std::vector<real> b;			//local right hand side
+		std::vector<real> lu;			//dense local LU factorization, indexes.size()^2, column-major
+		std::vector<Index> pivots;		//for lu
+		std::shared_ptr<Krylov<real>> solver;
+		std::vector<real> fullX, fullY;	//full-size scratch for Krylov local solves
+	};
+	std::vector<std::shared_ptr<Subdomain>> subdomains;
+
+	//coarse space Z^T A Z inverse, subdomains.size()^2, column-major
+	std::vector<real> coarseInverse;
+	std::vector<real> coarseB;
+	std::vector<real> coarseX;
+
+	std::vector<real> fullIn;	//copy of the input, in case it is the output as well
+
+	void setupSubdomain(Subdomain& subdomain);
+	void extractBlock(const Subdomain& subdomain, real* block);
+	void probeBlock(const Subdomain& subdomain, real* block);
+	void setupCoarseSpace();
+	void solveSubdomain(Subdomain& subdomain);
+};
+
+}
+
+
+#include "Solver/Parallel.h"
+#include <string.h>	//memcpy
+#include <cmath>	//isfinite
+#include <algorithm>
+
+namespace Solver {
+
+template<typename real>
+AdditiveSchwarz<real>::AdditiveSchwarz(size_t n_, Func A_, bool restricted_)
+: restricted(restricted_)
+, useCoarseSpace(false)
+, numThreads(0)
+, n(n_)
+, A(A_)
+, csr(nullptr)
+, isSetup(false)
+, fullIn(n_)
+{}
+
+template<typename real>
+AdditiveSchwarz<real>::AdditiveSchwarz(const CSR<real>& A_, bool restricted_)
+: AdditiveSchwarz(A_.rows, A_.getFunc(), restricted_)
+{
+	csr = &A_;
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::addSubdomain(const std::vector<size_t>& indexes, const std::vector<size_t>& owned, CreateSolver createSolver) {
+	auto subdomain = std::make_shared<Subdomain>();
+	subdomain->indexes = indexes;
+	subdomain->owned = owned;
+	subdomain->isOwned.resize(indexes.size());
+	std::vector<size_t> sortedOwned = owned;
+	std::sort(sortedOwned.begin(), sortedOwned.end());
+	for (Index i = 0; i < (Index)indexes.size(); ++i) {
+		subdomain->isOwned[i] = std::binary_search(sortedOwned.begin(), sortedOwned.end(), indexes[i]);
+	}
+	size_t m = indexes.size();
+	subdomain->x.resize(m);
+	subdomain->b.resize(m);
+	if (createSolver) {
+		subdomain->fullX.resize(n);
+		subdomain->fullY.resize(n);
+		Subdomain* s = subdomain.get();
+		subdomain->solver = createSolver(m, s->x.data(), s->b.data(), [this, s](real* y, const real* x) {
+			//y = R A R^T x
+			std::fill(s->fullX.begin(), s->fullX.end(), real());
+			for (Index i = 0; i < (Index)s->indexes.size(); ++i) {
+				s->fullX[s->indexes[i]] = x[i];
+			}
+			A(s->fullY.data(), s->fullX.data());
+			for (Index i = 0; i < (Index)s->indexes.size(); ++i) {
+				y[i] = s->fullY[s->indexes[i]];
+			}
+		});
+	}
+	subdomains.push_back(subdomain);
+	isSetup = false;
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::addContiguousSubdomains(size_t numSubdomains, size_t overlap, CreateSolver createSolver) {
+	for (size_t k = 0; k < numSubdomains; ++k) {
+		size_t begin, end;
+		Parallel::getRange(n, k, numSubdomains, begin, end);
+		std::vector<size_t> owned;
+		for (size_t i = begin; i < end; ++i) {
+			owned.push_back(i);
+		}
+		std::vector<size_t> indexes;
+		for (size_t i = begin > overlap ? begin - overlap : 0; i < std::min(end + overlap, n); ++i) {
+			indexes.push_back(i);
+		}
+		addSubdomain(indexes, owned, createSolver);
+	}
+}
+
+//block = R A R^T, read from the rows of the CSR matrix
+template<typename real>
+void AdditiveSchwarz<real>::extractBlock(const Subdomain& subdomain, real* block) {
+	size_t m = subdomain.indexes.size();
+	std::vector<Index> whereLocal(n, -1);
+	for (Index i = 0; i < (Index)m; ++i) {
+		whereLocal[subdomain.indexes[i]] = i;
+	}
+	std::fill(block, block + m * m, real());
+	for (Index i = 0; i < (Index)m; ++i) {
+		Index row = (Index)subdomain.indexes[i];
+		for (Index k = csr->rowOffsets[row]; k < csr->rowOffsets[row+1]; ++k) {
+			Index j = whereLocal[csr->colIndexes[k]];
+			if (j != -1) block[i + m * j] = csr->values[k];
+		}
+	}
+}
+
+//block = R A R^T, by probing A with unit vectors
+template<typename real>
+void AdditiveSchwarz<real>::probeBlock(const Subdomain& subdomain, real* block) {
+	size_t m = subdomain.indexes.size();
+	std::vector<real> e(n), Ae(n);
+	for (Index j = 0; j < (Index)m; ++j) {
+		e[subdomain.indexes[j]] = 1;
+		A(Ae.data(), e.data());
+		e[subdomain.indexes[j]] = 0;
+		for (Index i = 0; i < (Index)m; ++i) {
+			block[i + m * j] = Ae[subdomain.indexes[i]];
+		}
+	}
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::setupSubdomain(Subdomain& subdomain) {
+	if (subdomain.solver) return;
+	size_t m = subdomain.indexes.size();
+	subdomain.lu.resize(m * m);
+	subdomain.pivots.resize(m);
+	if (csr) {
+		extractBlock(subdomain, subdomain.lu.data());
+	} else {
+		probeBlock(subdomain, subdomain.lu.data());
+	}
+
+	Index singularColumn = LU<real>().tryFactor(m, subdomain.lu.data(), subdomain.pivots.data());
+	if (singularColumn >= 0) {
+		throw Common::Exception() << "AdditiveSchwarz local block is singular, zero pivot at unknown " << subdomain.indexes[singularColumn];
+	}
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::setupCoarseSpace() {
+	size_t numSubdomains = subdomains.size();
+	coarseInverse.resize(numSubdomains * numSubdomains);
+	coarseB.resize(numSubdomains);
+	coarseX.resize(numSubdomains);
+	real* coarse = coarseInverse.data();
+
+	//coarse[i,j] = z_i^T A z_j, for z_j the indicator of subdomain j's owned set
+	std::vector<real> z(n), Az(n);
+	for (Index j = 0; j < (Index)numSubdomains; ++j) {
+		for (size_t k : subdomains[j]->owned) z[k] = 1;
+		A(Az.data(), z.data());
+		for (size_t k : subdomains[j]->owned) z[k] = 0;
+		for (Index i = 0; i < (Index)numSubdomains; ++i) {
+			real sum = 0;
+			for (size_t k : subdomains[i]->owned) sum += Az[k];
+			coarse[i + numSubdomains * j] = sum;
+		}
+	}
+
+	HouseholderQR<real>().matrixInverse(numSubdomains, coarse, coarse);
+	for (Index i = 0; i < (Index)(numSubdomains * numSubdomains); ++i) {
+		if (!std::isfinite(coarse[i])) {
+			throw Common::Exception() << "AdditiveSchwarz coarse space matrix is singular";
+		}
+	}
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::setup() {
+	Parallel::forEach(subdomains.size(), numThreads, [this](size_t k) {
+		setupSubdomain(*subdomains[k]);
+	});
+	if (useCoarseSpace) setupCoarseSpace();
+	isSetup = true;
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::solveSubdomain(Subdomain& subdomain) {
+	size_t m = subdomain.indexes.size();
+	for (Index i = 0; i < (Index)m; ++i) {
+		subdomain.b[i] = fullIn[subdomain.indexes[i]];
+	}
+	if (subdomain.solver) {
+		std::fill(subdomain.x.begin(), subdomain.x.end(), real());
+		subdomain.solver->solve();
+	} else {
+		LU<real>().solveFactored(m, subdomain.x.data(), subdomain.lu.data(), subdomain.pivots.data(), subdomain.b.data());
+	}
+}
+
+template<typename real>
+void AdditiveSchwarz<real>::operator()(real* y, const real* x) {
+	if (!isSetup || (useCoarseSpace && coarseInverse.empty())) setup();
+
+	memcpy(fullIn.data(), x, sizeof(real) * n);
+
+	Parallel::forEach(subdomains.size(), numThreads, [this, y](size_t k) {
+		Subdomain& subdomain = *subdomains[k];
+		solveSubdomain(subdomain);
+		//owned sets are disjoint, so these writes don't overlap between threads
+		for (Index i = 0; i < (Index)subdomain.indexes.size(); ++i) {
+			if (subdomain.isOwned[i]) y[subdomain.indexes[i]] = subdomain.x[i];
+		}
+	});
+
+	//unrestricted: add the overlapping contributions from the neighbors
+	if (!restricted) {
+		for (auto& subdomain : subdomains) {
+			for (Index i = 0; i < (Index)subdomain->indexes.size(); ++i) {
+				if (!subdomain->isOwned[i]) y[subdomain->indexes[i]] += subdomain->x[i];
+			}
+		}
+	}
+
+	if (useCoarseSpace) {
+		size_t numSubdomains = subdomains.size();
+		//coarseB = Z^T x
+		for (Index i = 0; i < (Index)numSubdomains; ++i) {
+			real sum = 0;
+			for (size_t k : subdomains[i]->owned) sum += fullIn[k];
+			coarseB[i] = sum;
+		}
+		//coarseX = (Z^T A Z)^-1 coarseB
+		const real* coarse = coarseInverse.data();
+		for (Index i = 0; i < (Index)numSubdomains; ++i) {
+			real sum = 0;
+			for (Index j = 0; j < (Index)numSubdomains; ++j) {
+				sum += coarse[i + numSubdomains * j] * coarseB[j];
+			}
+			coarseX[i] = sum;
+		}
+		//y += Z coarseX
+		for (Index i = 0; i < (Index)numSubdomains; ++i) {
+			for (size_t k : subdomains[i]->owned) y[k] += coarseX[i];
+		}
+	}
+}
+
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <memory>
+#include <new>	//bad_alloc
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+allocator for solver-owned vectors
+
+firstTouch: memory is zeroed with Parallel::forRange, so range t of the pages is touched by the pinned pool worker
+that also runs range t of every Parallel kernel with the same numThreads (CSR products, Expr statements, ...),
+and on a NUMA system lands on that worker's node.  match numThreads to the solvers' numThreads for this to hold.
+vectors only used by serial code get no benefit beyond being zeroed.
+interleave: pages are instead spread round-robin across the online NUMA nodes (linux only, ignored elsewhere).
+
+hugePages: allocations of at least hugePagesMinBytes are backed by huge pages, to cut TLB misses when streaming through large bases.
+explicit hugetlbfs pages need pages reserved by the admin (/proc/sys/vm/nr_hugepages).
+each allocation falls back from 1GB to 2MB hugetlbfs pages, then to transparent huge pages, then to normal pages,
+and getAllocations() / reportCallback tell which one each named buffer got.
+transparent huge pages are only requested, and reported, when /sys/kernel/mm/transparent_hugepage/enabled isn't "never",
+and even then the kernel backs what it can: AnonHugePages in /proc/self/smaps has the final word.
+
+bookkeeping for getAllocations() is opt-in with trackAllocations, so that by default an allocation takes no lock.
+
+allocations are page-aligned, and must be released with deallocate() of the same allocator.
+getDefault() is shared by every solver that isn't given an allocator, so setting its fields changes them all.
+*/
+template<typename real>
+struct Allocator {
+	Allocator();
+	virtual ~Allocator();
+
+	typedef enum {
+		PAGES_DEFAULT,
+		PAGES_TRANSPARENT_HUGE,	//madvise(MADV_HUGEPAGE), with THP enabled
+		PAGES_HUGETLB_2MB,		//mmap(MAP_HUGETLB)
+		PAGES_HUGETLB_1GB,
+	} pages_t;
+
+	static const char* getPagesName(pages_t pages);
+
+	struct Allocation {
+		std::string name;
+		size_t bytes;		//requested
+		size_t mappedBytes;	//after rounding to the page size
+		pages_t pages;		//what the allocation actually got
+	};
+
+	/*
+	returns n zeroed elements
+	name is optional, for reporting
+	*/
+	virtual real* allocate(size_t n, const char* name = nullptr);
+
+	//n must match the allocate() call
+	virtual void deallocate(real* p, size_t n);
+
+	//currently live allocations made while trackAllocations was set
+	std::vector<Allocation> getAllocations() const;
+
+	//optional.  called after each allocation, whether or not it is tracked.
+	std::function<void(const Allocation&)> reportCallback;
+
+	//record allocations for getAllocations().  default false.  costs a lock and a map insertion per allocation.
+	bool trackAllocations;
+
+	//zero memory across threads.  default true.
+	bool firstTouch;
+
+	//interleave pages across NUMA nodes.  default false.
+	bool interleave;
+
+	//threads to first-touch with.  0 = Parallel default.
+	size_t numThreads;
+
+	//allocations smaller than this are touched by the calling thread only
+	size_t parallelMinBytes;
+
+	//largest page size to try.  default PAGES_DEFAULT = no huge pages.
+	pages_t hugePages;
+
+	//allocations smaller than this use normal pages.  default 2MB.
+	size_t hugePagesMinBytes;
+
+	//the allocator used by solvers that aren't given one
+	static std::shared_ptr<Allocator> getDefault();
+
+protected:
+	static size_t getPageSize();
+
+	//returns false if the pages couldn't be interleaved
+	static bool interleavePages(void* p, size_t bytes);
+
+	//whether the kernel will give transparent huge pages to madvise(MADV_HUGEPAGE) memory
+	static bool transparentHugePagesEnabled();
+
+	/*
+	tries the page sizes from hugePages downward
+	returns nullptr if none worked, otherwise sets allocation's mappedBytes and pages
+	*/
+	void* allocateHugePages(Allocation& allocation);
+
+	//adds to allocations if trackAllocations is set, then calls reportCallback
+	void recordAllocation(const void* p, const Allocation& allocation);
+
+	//removes p from allocations, if it is there
+	void forgetAllocation(const void* p);
+
+	mutable std::mutex allocationsMutex;
+	std::map<const void*, Allocation> allocations;
+
+	//mapped bytes of each hugetlb allocation, always kept since munmap needs them
+	std::map<const void*, size_t> hugetlbMappings;
+
+	//entries in allocations and hugetlbMappings, so that deallocations skip the lock when there are none
+	std::atomic<size_t> numRecorded;
+};
+
+/*
+owns an allocation for the lifetime of a solve
+contents are zeroed whenever the size changes
+*/
+template<typename real>
+struct Buffer {
+	Buffer(std::shared_ptr<Allocator<real>> allocator, size_t n = 0, const char* name = nullptr);
+	~Buffer();
+	Buffer(const Buffer&) = delete;
+	Buffer& operator=(const Buffer&) = delete;
+
+	void resize(size_t n);
+	void clear() { resize(0); }
+
+	real* data() { return p; }
+	const real* data() const { return p; }
+	size_t size() const { return n; }
+	bool empty() const { return !n; }
+
+protected:
+	std::shared_ptr<Allocator<real>> allocator;
+	real* p;
+	size_t n;
+	std::string name;
+};
+
+}
+
+
+#include "Solver/Parallel.h"
+#include <string.h>	//memset
+#if defined(__linux__)
+#include <unistd.h>	//sysconf, syscall
+#include <sys/syscall.h>	//SYS_mbind
+#include <linux/mempolicy.h>	//MPOL_INTERLEAVE
+#include <stdio.h>	//reading the online node list
+#include <sys/mman.h>	//mmap, madvise
+#endif
+
+namespace Solver {
+
+template<typename real>
+Allocator<real>::Allocator()
+: trackAllocations(false)
+, firstTouch(true)
+, interleave(false)
+, numThreads(0)
+, parallelMinBytes(1 << 20)
+, hugePages(PAGES_DEFAULT)
+, hugePagesMinBytes(1 << 21)
+, numRecorded(0)
+{}
+
+template<typename real>
+Allocator<real>::~Allocator() {}
+
+template<typename real>
+size_t Allocator<real>::getPageSize() {
+#if defined(__linux__)
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if (pageSize > 0) return (size_t)pageSize;
+#endif
+	return 4096;
+}
+
+template<typename real>
+bool Allocator<real>::interleavePages(void* p, size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+	//parse /sys/devices/system/node/online, i.e. "0-1" or "0,2-3"
+	FILE* file = fopen("/sys/devices/system/node/online", "r");
+	if (!file) return false;
+	std::vector<unsigned long> nodeMask;
+	const size_t bitsPerWord = sizeof(unsigned long) * 8;
+	int first, last;
+	char separator;
+	while (fscanf(file, "%d", &first) == 1) {
+		last = first;
+		if (fscanf(file, "%c", &separator) == 1 && separator == '-') {
+			if (fscanf(file, "%d", &last) != 1) break;
+			if (fscanf(file, "%c", &separator) != 1) separator = 0;
+		}
+		for (int node = first; node <= last; ++node) {
+			if (nodeMask.size() <= node / bitsPerWord) nodeMask.resize(node / bitsPerWord + 1);
+			nodeMask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+		}
+		if (separator != ',') break;
+	}
+	fclose(file);
+	if (nodeMask.empty()) return false;
+	return syscall(SYS_mbind, p, bytes, MPOL_INTERLEAVE, nodeMask.data(), nodeMask.size() * bitsPerWord + 1, 0) == 0;
+#else
+	return false;
+#endif
+}
+
+template<typename real>
+bool Allocator<real>::transparentHugePagesEnabled() {
+#if defined(__linux__)
+	//i.e. "always [madvise] never", with the current mode bracketed
+	static const bool enabled = []() {
+		FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+		if (!file) return false;
+		char buffer[256] = {};
+		size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+		fclose(file);
+		buffer[length] = 0;
+		return strstr(buffer, "[always]") || strstr(buffer, "[madvise]");
+	}();
+	return enabled;
+#else
+	return false;
+#endif
+}
+
+template<typename real>
+const char* Allocator<real>::getPagesName(pages_t pages) {
+	switch (pages) {
+	case PAGES_TRANSPARENT_HUGE: return "transparent huge pages";
+	case PAGES_HUGETLB_2MB: return "2MB hugetlb pages";
+	case PAGES_HUGETLB_1GB: return "1GB hugetlb pages";
+	default: return "default pages";
+	}
+}
+
+template<typename real>
+void* Allocator<real>::allocateHugePages(Allocation& allocation) {
+#if defined(__linux__)
+	const size_t hugePageSize2MB = (size_t)1 << 21;
+	const size_t hugePageSize1GB = (size_t)1 << 30;
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+	for (pages_t pages = hugePages; pages >= PAGES_HUGETLB_2MB; pages = (pages_t)(pages - 1)) {
+		size_t hugePageSize = pages == PAGES_HUGETLB_1GB ? hugePageSize1GB : hugePageSize2MB;
+		int sizeFlag = (pages == PAGES_HUGETLB_1GB ? 30 : 21) << MAP_HUGE_SHIFT;
+		size_t mappedBytes = (allocation.bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+		void* p = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | sizeFlag, -1, 0);
+		if (p != MAP_FAILED) {
+			allocation.mappedBytes = mappedBytes;
+			allocation.pages = pages;
+			return p;
+		}
+	}
+#endif
+#if defined(MADV_HUGEPAGE)
+	if (!transparentHugePagesEnabled()) return nullptr;
+	//align to the huge page size so khugepaged can back the whole range
+	size_t mappedBytes = (allocation.bytes + hugePageSize2MB - 1) / hugePageSize2MB * hugePageSize2MB;
+	void* p = nullptr;
+	if (posix_memalign(&p, hugePageSize2MB, mappedBytes)) return nullptr;
+	if (madvise(p, mappedBytes, MADV_HUGEPAGE)) {
+		free(p);
+		return nullptr;
+	}
+	allocation.mappedBytes = mappedBytes;
+	allocation.pages = PAGES_TRANSPARENT_HUGE;
+	return p;
+#endif
+#endif
+	return nullptr;
+}
+
+template<typename real>
+real* Allocator<real>::allocate(size_t n, const char* name) {
+	size_t pageSize = getPageSize();
+	size_t bytes = sizeof(real) * n;
+
+	Allocation allocation;
+	if (name && (trackAllocations || reportCallback)) allocation.name = name;
+	allocation.bytes = bytes;
+	allocation.mappedBytes = 0;
+	allocation.pages = PAGES_DEFAULT;
+
+	void* p = nullptr;
+	if (hugePages != PAGES_DEFAULT && bytes >= hugePagesMinBytes) {
+		p = allocateHugePages(allocation);
+		if (allocation.pages == PAGES_HUGETLB_1GB) pageSize = (size_t)1 << 30;
+		else if (allocation.pages != PAGES_DEFAULT) pageSize = (size_t)1 << 21;
+	}
+	if (!p) {
+		allocation.mappedBytes = (bytes + pageSize - 1) / pageSize * pageSize;
+		if (!allocation.mappedBytes) allocation.mappedBytes = pageSize;
+		if (posix_memalign(&p, pageSize, allocation.mappedBytes)) throw std::bad_alloc();
+	}
+
+	//placement policy has to be set before the pages are touched
+	if (interleave) interleavePages(p, allocation.mappedBytes);
+
+	char* c = (char*)p;
+	if (firstTouch && !interleave && bytes >= parallelMinBytes) {
+		//touch each thread's range of elements, rounded to pages
+		Parallel::forRange(n, numThreads, [c, pageSize, n](size_t begin, size_t end) {
+			size_t byteBegin = begin == 0 ? 0 : (sizeof(real) * begin + pageSize - 1) / pageSize * pageSize;
+			size_t byteEnd = end == n ? sizeof(real) * n : (sizeof(real) * end + pageSize - 1) / pageSize * pageSize;
+			if (byteEnd > sizeof(real) * n) byteEnd = sizeof(real) * n;
+			if (byteEnd > byteBegin) memset(c + byteBegin, 0, byteEnd - byteBegin);
+		});
+	} else {
+		memset(c, 0, bytes);
+	}
+
+	if (allocation.pages == PAGES_HUGETLB_2MB || allocation.pages == PAGES_HUGETLB_1GB) {
+		std::lock_guard<std::mutex> lock(allocationsMutex);
+		hugetlbMappings[p] = allocation.mappedBytes;
+		++numRecorded;
+	}
+	recordAllocation(p, allocation);
+	return (real*)p;
+}
+
+template<typename real>
+void Allocator<real>::deallocate(real* p, size_t) {
+	if (!p) return;
+	forgetAllocation(p);
+	size_t hugetlbBytes = 0;
+	if (numRecorded) {
+		std::lock_guard<std::mutex> lock(allocationsMutex);
+		auto i = hugetlbMappings.find(p);
+		if (i != hugetlbMappings.end()) {
+			hugetlbBytes = i->second;
+			hugetlbMappings.erase(i);
+			--numRecorded;
+		}
+	}
+#if defined(__linux__)
+	if (hugetlbBytes) {
+		munmap(p, hugetlbBytes);
+		return;
+	}
+#endif
+	free(p);
+}
+
+template<typename real>
+void Allocator<real>::recordAllocation(const void* p, const Allocation& allocation) {
+	if (trackAllocations) {
+		std::lock_guard<std::mutex> lock(allocationsMutex);
+		if (allocations.emplace(p, allocation).second) ++numRecorded;
+	}
+	if (reportCallback) reportCallback(allocation);
+}
+
+template<typename real>
+void Allocator<real>::forgetAllocation(const void* p) {
+	if (!numRecorded) return;
+	std::lock_guard<std::mutex> lock(allocationsMutex);
+	if (allocations.erase(p)) --numRecorded;
+}
+
+template<typename real>
+std::vector<typename Allocator<real>::Allocation> Allocator<real>::getAllocations() const {
+	std::lock_guard<std::mutex> lock(allocationsMutex);
+	std::vector<Allocation> results;
+	for (const auto& i : allocations) {
+		results.push_back(i.second);
+	}
+	return results;
+}
+
+template<typename real>
+std::shared_ptr<Allocator<real>> Allocator<real>::getDefault() {
+	static std::shared_ptr<Allocator<real>> allocator = std::make_shared<Allocator<real>>();
+	return allocator;
+}
+
+template<typename real>
+Buffer<real>::Buffer(std::shared_ptr<Allocator<real>> allocator_, size_t n_, const char* name_)
+: allocator(allocator_ ? allocator_ : Allocator<real>::getDefault())
+, p(nullptr)
+, n(0)
+, name(name_ ? name_ : "")
+{
+	resize(n_);
+}
+
+template<typename real>
+Buffer<real>::~Buffer() {
+	clear();
+}
+
+template<typename real>
+void Buffer<real>::resize(size_t n_) {
+	if (n_ == n) return;
+	if (p) allocator->deallocate(p, n);
+	p = nullptr;
+	n = n_;
+	if (n) p = allocator->allocate(n, name.c_str());
+}
+
+}
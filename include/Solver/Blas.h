@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+optional system BLAS / LAPACK backend for the dense and vector kernels
+
+define SOLVER_USE_BLAS and link a Fortran-interface BLAS and LAPACK (OpenBLAS, or reference -llapack -lblas)
+to send the float and double kernels of Vector, DenseInverse and GMRES to them.
+without it, and always for the other scalar types, the built-in loops are used, and the API is the same either way.
+define SOLVER_BLAS_ILP64 as well for a BLAS built with 64-bit integers.
+both must be defined the same way for the library and everything that includes its headers.
+nothing in buildinfo or the Makefiles detects a BLAS: defining the macros and adding the libraries to the link is up to the build.
+
+sizes beyond BlasInt's range throw, except in dot and axpy, which split them into chunks.
+LAPACK's invalid-argument info < 0 throws as well.
+
+callers test Blas<real>::enabled with if constexpr, so the built-in types never reference the specializations below.
+*/
+
+#include "Solver/Index.h"
+#include <stdlib.h>	//size_t
+#include <stdint.h>	//int64_t
+
+namespace Solver {
+
+#if defined(SOLVER_BLAS_ILP64)
+using BlasInt = int64_t;
+#else
+using BlasInt = int;
+#endif
+
+template<typename real>
+struct Blas {
+	static constexpr bool enabled = false;
+};
+
+#if defined(SOLVER_USE_BLAS)
+
+/*
+matrices are column-major with leading dimension lda
+factorizations return LAPACK's info: 0 on success, > 0 for a singular / not positive-definite matrix
+the solves, which only fail on invalid arguments, throw instead
+*/
+template<>
+struct Blas<float> {
+	static constexpr bool enabled = true;
+	//sum x[i] y[i]
+	static float dot(size_t n, const float* x, const float* y);
+	//y += alpha x
+	static void axpy(size_t n, float alpha, const float* x, float* y);
+	//y = alpha a[m,n] x + beta y
+	static void gemv(size_t m, size_t n, float alpha, const float* a, size_t lda, const float* x, float beta, float* y);
+	//x = a^-1 x, a upper-triangular n * n
+	static void trsvUpper(size_t n, const float* a, size_t lda, float* x);
+	//a[m,n] = q r, r in the upper triangle, q as reflectors below it and in tau[n]
+	static BlasInt geqrf(size_t m, size_t n, float* a, size_t lda, float* tau);
+	//c[m,nrhs] = q^T c, q from geqrf of k reflectors
+	static void ormqrT(size_t m, size_t nrhs, size_t k, const float* a, size_t lda, const float* tau, float* c, size_t ldc);
+	//a = p l u, l unit-lower, 1-based pivots in ipiv[n]
+	static BlasInt getrf(size_t n, float* a, size_t lda, BlasInt* ipiv);
+	//b[n,nrhs] = a^-1 b from getrf
+	static void getrs(size_t n, size_t nrhs, const float* a, size_t lda, const BlasInt* ipiv, float* b, size_t ldb);
+	//a = l l^T, l in the lower triangle
+	static BlasInt potrf(size_t n, float* a, size_t lda);
+	//b[n,nrhs] = a^-1 b from potrf
+	static void potrs(size_t n, size_t nrhs, const float* a, size_t lda, float* b, size_t ldb);
+};
+
+template<>
+struct Blas<double> {
+	static constexpr bool enabled = true;
+	static double dot(size_t n, const double* x, const double* y);
+	static void axpy(size_t n, double alpha, const double* x, double* y);
+	static void gemv(size_t m, size_t n, double alpha, const double* a, size_t lda, const double* x, double beta, double* y);
+	static void trsvUpper(size_t n, const double* a, size_t lda, double* x);
+	static BlasInt geqrf(size_t m, size_t n, double* a, size_t lda, double* tau);
+	static void ormqrT(size_t m, size_t nrhs, size_t k, const double* a, size_t lda, const double* tau, double* c, size_t ldc);
+	static BlasInt getrf(size_t n, double* a, size_t lda, BlasInt* ipiv);
+	static void getrs(size_t n, size_t nrhs, const double* a, size_t lda, const BlasInt* ipiv, double* b, size_t ldb);
+	static BlasInt potrf(size_t n, double* a, size_t lda);
+	static void potrs(size_t n, size_t nrhs, const double* a, size_t lda, double* b, size_t ldb);
+};
+
+#endif
+
+}
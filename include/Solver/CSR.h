@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Solver/Index.h"
+#include "Solver/Krylov.h"
+#include <vector>
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+compressed sparse row matrix
+row i's entries are colIndexes[rowOffsets[i]] through colIndexes[rowOffsets[i+1]-1], sorted by column
+*/
+template<typename real>
+struct CSR {
+	using Func = typename Krylov<real>::Func;
+
+	struct Triplet {
+		Index row;
+		Index col;
+		real value;
+	};
+
+	CSR(size_t rows = 0, size_t cols = 0);
+
+	/*
+	builds a matrix from (row, col, value) triplets, in any order
+	duplicate entries are summed
+	*/
+	static CSR fromTriplets(size_t rows, size_t cols, std::vector<Triplet> triplets);
+
+	size_t rows, cols;
+	std::vector<Index> rowOffsets;	//[rows+1]
+	std::vector<Index> colIndexes;	//[nnz]
+	std::vector<real> values;		//[nnz]
+
+	size_t getNNZ() const { return values.size(); }
+
+	//returns the value at (i,j), or 0 if it is not stored
+	real get(Index i, Index j) const;
+
+	//y = A x, split by rows across numThreads.  y and x cannot be the same memory.
+	void mul(real* y, const real* x, size_t numThreads = 1) const;
+
+	CSR transpose() const;
+
+	//returns a Func that calls mul.  references this object.
+	Func getFunc(size_t numThreads = 1) const {
+		return [this, numThreads](real* y, const real* x) { mul(y, x, numThreads); };
+	}
+};
+
+}
+
+
+#include "Solver/Parallel.h"
+#include <algorithm>
+
+namespace Solver {
+
+template<typename real>
+CSR<real>::CSR(size_t rows_, size_t cols_)
+: rows(rows_)
+, cols(cols_)
+, rowOffsets(rows_ + 1)
+{}
+
+template<typename real>
+CSR<real> CSR<real>::fromTriplets(size_t rows, size_t cols, std::vector<Triplet> triplets) {
+	std::sort(triplets.begin(), triplets.end(), [](const Triplet& a, const Triplet& b) {
+		return a.row < b.row || (a.row == b.row && a.col < b.col);
+	});
+	CSR a(rows, cols);
+	for (Index k = 0; k < (Index)triplets.size(); ++k) {
+		const Triplet& t = triplets[k];
+		if (k > 0 && t.row == triplets[k-1].row && t.col == triplets[k-1].col) {
+			a.values.back() += t.value;
+		} else {
+			a.colIndexes.push_back(t.col);
+			a.values.push_back(t.value);
+			++a.rowOffsets[t.row + 1];
+		}
+	}
+	for (Index i = 0; i < (Index)rows; ++i) {
+		a.rowOffsets[i+1] += a.rowOffsets[i];
+	}
+	return a;
+}
+
+template<typename real>
+real CSR<real>::get(Index i, Index j) const {
+	const Index* begin = colIndexes.data() + rowOffsets[i];
+	const Index* end = colIndexes.data() + rowOffsets[i+1];
+	const Index* found = std::lower_bound(begin, end, j);
+	if (found == end || *found != j) return real();
+	return values[found - colIndexes.data()];
+}
+
+template<typename real>
+void CSR<real>::mul(real* y, const real* x, size_t numThreads) const {
+	Parallel::forRange(rows, numThreads, [&](size_t begin, size_t end) {
+		for (Index i = (Index)begin; i < (Index)end; ++i) {
+			real sum = 0;
+			for (Index k = rowOffsets[i]; k < rowOffsets[i+1]; ++k) {
+				sum += values[k] * x[colIndexes[k]];
+			}
+			y[i] = sum;
+		}
+	});
+}
+
+template<typename real>
+CSR<real> CSR<real>::transpose() const {
+	CSR at(cols, rows);
+	at.colIndexes.resize(getNNZ());
+	at.values.resize(getNNZ());
+	for (Index k = 0; k < (Index)getNNZ(); ++k) {
+		++at.rowOffsets[colIndexes[k] + 1];
+	}
+	for (Index j = 0; j < (Index)cols; ++j) {
+		at.rowOffsets[j+1] += at.rowOffsets[j];
+	}
+	//rows are visited in order, so each transposed row comes out sorted
+	std::vector<Index> next(at.rowOffsets.begin(), at.rowOffsets.end() - 1);
+	for (Index i = 0; i < (Index)rows; ++i) {
+		for (Index k = rowOffsets[i]; k < rowOffsets[i+1]; ++k) {
+			Index dst = next[colIndexes[k]]++;
+			at.colIndexes[dst] = i;
+			at.values[dst] = values[k];
+		}
+	}
+	return at;
+}
+
+}
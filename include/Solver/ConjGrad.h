@@ -4,80 +4,129 @@
 
 namespace Solver {
 
+/*
+if trustRadius is set then this is Steihaug's truncated CG:
+Steihaug (1983). "The Conjugate Gradient Method and Trust Regions in Large Scale Optimization." SIAM Journal on Numerical Analysis vol. 20 no. 3
+the radius is measured in the L2 norm, even when MInv is provided
+*/
 template<typename real>
 struct ConjGrad : public Krylov<real> {
 	using Super = Krylov<real>;
 	using Super::Super; 
+	using Magnitude = typename Super::Magnitude;
+	using Traits = ScalarTraits<real>;
 	virtual void solve();
+
+	//elements of WorkspaceAllocator space solve() needs
+	static size_t getWorkspaceSize(size_t n, bool preconditioned);
 };
 
 }
 
 
 #include "Solver/Vector.h"
-#include <vector>
-#include <string.h>	//memcpy
+#include "Solver/Expr.h"
 
 namespace Solver {
 
+template<typename real>
+size_t ConjGrad<real>::getWorkspaceSize(size_t n, bool preconditioned) {
+	return WorkspaceAllocator<real>::getAllocationSize(n) * (preconditioned ? 4 : 3);
+}
+
 template<typename real>
 void ConjGrad<real>::solve() {
-	std::vector<real> r_(this->n);
+	Buffer<real> r_(this->allocator, this->n, "ConjGrad r");
 	real* r = r_.data();
-	std::vector<real> p_(this->n);
+	Buffer<real> p_(this->allocator, this->n, "ConjGrad p");
 	real* p = p_.data();
-	std::vector<real> Ap_(this->n);
+	Buffer<real> Ap_(this->allocator, this->n, "ConjGrad Ap");
 	real* Ap = Ap_.data();
-	std::vector<real> MInvR_(this->MInv ? this->n : 0);
+	Buffer<real> MInvR_(this->allocator, this->MInv ? this->n : 0, "ConjGrad MInvR");
 	real* MInvR = this->MInv ? MInvR_.data() : r;
-	
-	real bNormL2 = Vector<real>::normL2(this->n, this->b);
+
+	size_t numThreads = this->numThreads;
+	auto xv = view(this->n, this->x);
+	auto bv = view(this->n, this->b);
+	auto rv = view(this->n, r);
+	auto pv = view(this->n, p);
+	auto Apv = view(this->n, Ap);
+	auto MInvRv = view(this->n, MInvR);
+
+	auto bb = dot(bv, bv);
+	evalParallel(numThreads, bb);
+	Magnitude bNormL2 = sqrt(Traits::realPart(bb));
+	this->iter = 0;
 
 	//r = this->b - this->A(this->x)
 	this->A(r, this->x);
-	for (int i = 0; i < (int)this->n; ++i) {
-		r[i] = this->b[i] - r[i];
-	}
+	auto rr = dot(rv, rv);
+	evalParallel(numThreads, rv = bv - rv, rr);
 	
 	//MInvR = this->MInv(r)
 	if (this->MInv) this->MInv(MInvR, r);	//else MInvR is already r ...
 	
-	real rDotMInvR = Vector<real>::dot(this->n, r, MInvR);
-	real rNormL2 = Vector<real>::normL2(this->n, r);
+	auto rMInvR = dot(rv, MInvRv);
+	evalParallel(numThreads, rMInvR);
+	real rDotMInvR = rMInvR;
+	Magnitude rNormL2 = sqrt(Traits::realPart(rr));
 	this->residual = this->calcResidual(rNormL2, bNormL2, r);
 	do {
 		if (this->stop()) break;
-		memcpy(p, MInvR, sizeof(real) * this->n);
+		evalParallel(numThreads, pv = MInvRv);
 		for (this->iter = 1; this->iter <= this->maxiter; ++this->iter) {
 			//alpha = dot(r, this->MInv(r)) / dot(p, this->A(p))
 			this->A(Ap, p);
-			real alpha = rDotMInvR / Vector<real>::dot(this->n, p, Ap);
-			
-			for (int i = 0; i < (int)this->n; ++i) {
-				this->x[i] += p[i] * alpha;
-				r[i] -= Ap[i] * alpha;
+			auto pAp_ = dot(pv, Apv);
+			evalParallel(numThreads, pAp_);
+			real pAp = pAp_;
+			real alpha = rDotMInvR / pAp;
+
+			//Steihaug: on negative curvature or leaving the trust region, step to the boundary and stop
+			if (this->trustRadius > 0) {
+				bool boundary = Traits::realPart(pAp) <= 0;
+				if (!boundary) {
+					Magnitude xNormL2 = 0;
+					for (Index i = 0; i < (Index)this->n; ++i) {
+						real xi = this->x[i] + p[i] * alpha;
+						xNormL2 += Traits::abs2(xi);
+					}
+					boundary = sqrt(xNormL2) >= this->trustRadius;
+				}
+				if (boundary) {
+					Magnitude tau = this->stepToRadius(this->n, this->x, p, this->trustRadius);
+					for (Index i = 0; i < (Index)this->n; ++i) {
+						this->x[i] += p[i] * tau;
+						r[i] -= Ap[i] * tau;
+					}
+					rNormL2 = Vector<real>::normL2(this->n, r);
+					this->residual = this->calcResidual(rNormL2, bNormL2, r);
+					this->stopReason = Super::STOP_TRUST_REGION_BOUNDARY;
+					break;
+				}
 			}
 			
-			rNormL2 = Vector<real>::normL2(this->n, r);
+			//x += alpha p, r -= alpha Ap, and |r|^2 in one pass
+			auto nrr = dot(rv, rv);
+			evalParallel(numThreads, xv += pv * alpha, rv -= Apv * alpha, nrr);
+			
+			rNormL2 = sqrt(Traits::realPart(nrr));
 			this->residual = this->calcResidual(rNormL2, bNormL2, r);
 			if (this->stop()) break;
 			
-			if (this->MInv) this->MInv(MInvR, r);
-			real nRDotMInvR = Vector<real>::dot(this->n, r, MInvR);
+			real nRDotMInvR = nrr;
+			if (this->MInv) {
+				this->MInv(MInvR, r);
+				auto nRMInvR = dot(rv, MInvRv);
+				evalParallel(numThreads, nRMInvR);
+				nRDotMInvR = nRMInvR;
+			}
 			real beta = nRDotMInvR / rDotMInvR;
 	
-			for (int i = 0; i < (int)this->n; ++i) {
-				p[i] *= beta;
-				p[i] += MInvR[i];
-			}
+			evalParallel(numThreads, pv = pv * beta + MInvRv);
 			rDotMInvR = nRDotMInvR;
 		}
 	} while (0);
-	
-	delete[] r;
-	delete[] p;
-	delete[] Ap;
-	if (this->MInv) delete[] MInvR;
 }
 
 }
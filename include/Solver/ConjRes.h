@@ -9,6 +9,9 @@ struct ConjRes : public Krylov<real> {
 	using Super = Krylov<real>;
 	using Super::Super;
 	virtual void solve();
+
+	//elements of WorkspaceAllocator space solve() needs
+	static size_t getWorkspaceSize(size_t n, bool preconditioned);
 };
 
 }
@@ -19,19 +22,30 @@ struct ConjRes : public Krylov<real> {
 
 namespace Solver {
 
+template<typename real>
+size_t ConjRes<real>::getWorkspaceSize(size_t n, bool preconditioned) {
+	return WorkspaceAllocator<real>::getAllocationSize(n) * (preconditioned ? 5 : 4);
+}
+
 template<typename real>
 void ConjRes<real>::solve() {
-	real* r = new real[this->n];
-	real* p = new real[this->n];
-	real* Ap = new real[this->n];
-	real* Ar = new real[this->n];
-	real* MInvAp = !this->MInv ? Ap : new real[this->n];
+	Buffer<real> r_(this->allocator, this->n, "ConjRes r");
+	real* r = r_.data();
+	Buffer<real> p_(this->allocator, this->n, "ConjRes p");
+	real* p = p_.data();
+	Buffer<real> Ap_(this->allocator, this->n, "ConjRes Ap");
+	real* Ap = Ap_.data();
+	Buffer<real> Ar_(this->allocator, this->n, "ConjRes Ar");
+	real* Ar = Ar_.data();
+	Buffer<real> MInvAp_(this->allocator, this->MInv ? this->n : 0, "ConjRes MInvAp");
+	real* MInvAp = this->MInv ? MInvAp_.data() : Ap;
 	
 	real bNormL2 = Vector<real>::normL2(this->n, this->b);
+	this->iter = 0;
 
 	//r = this->MInv(this->b - this->A(this->x))
 	this->A(r, this->x);
-	for (int i = 0; i < (int)this->n; ++i) {
+	for (Index i = 0; i < (Index)this->n; ++i) {
 		r[i] = this->b[i] - r[i];
 	}
 	if (this->MInv) this->MInv(r, r);
@@ -49,7 +63,7 @@ void ConjRes<real>::solve() {
 			if (this->MInv) this->MInv(MInvAp, Ap);
 			real alpha = rAr / Vector<real>::dot(this->n, Ap, MInvAp);
 			
-			for (int i = 0; i < (int)this->n; ++i) {
+			for (Index i = 0; i < (Index)this->n; ++i) {
 				this->x[i] += p[i] * alpha;
 				r[i] -= MInvAp[i] * alpha;
 			}
@@ -64,7 +78,7 @@ void ConjRes<real>::solve() {
 
 			rAr = nrAr;
 
-			for (int i = 0; i < (int)this->n; ++i) {
+			for (Index i = 0; i < (Index)this->n; ++i) {
 				p[i] *= beta;
 				p[i] += r[i];
 				Ap[i] *= beta;
@@ -72,12 +86,6 @@ void ConjRes<real>::solve() {
 			}
 		}
 	}
-
-	delete[] r;
-	delete[] p;
-	delete[] Ap;
-	delete[] Ar;
-	if (this->MInv) delete[] MInvAp;
 }
 
 }
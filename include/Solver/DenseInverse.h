@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Solver/Index.h"
 #include "Common/Exception.h"
 #include <stddef.h>	//size_t
 
@@ -31,6 +32,15 @@ struct DenseInverse {
 	the only functional reason m is provided is for the column stride 
 	*/
 	void backSubstituteUpperTriangular(size_t m, size_t n, real* x, const real* a, const real* b);
+
+	/*
+	construct an inverse matrix
+	a size n * n
+	ainv size n * n
+	a and ainv can have the same memory
+	default implementation solves for one column of the inverse at a time using solveLinear
+	*/
+	virtual void matrixInverse(size_t n, real* ainv, const real* a);
 };
 
 template<typename real>
@@ -42,18 +52,32 @@ struct HouseholderQR : public DenseInverse<real> {
 	a is a m * jmax matrix
 	v is scratch vector size m (portions k through m are used)
 	*/
-	void applyQ(real* a, int m, int k, int jmin, int jmax, real* v);
+	void applyQ(real* a, Index m, Index k, Index jmin, Index jmax, real* v);
+
+	/*
+	helper function for Householder QR
+	v[0:m-k] = the unit reflector that zeroes column k of a[m][*] below row k
+	*/
+	void reflector(real* v, const real* a, Index m, Index k);
 	
 	/*
 	Algorithm 10.1 from Trefethen and Bau "Numerical Linear Algebra"
-	solves qt^T r = a for unitary q and upper-triangular r
+	solves qt^H r = a for unitary q and upper-triangular r
 	results:
-	qt[m][m] is the transpose of the unitary matrix solving q r = a
+	qt[m][m] is the conjugate transpose of the unitary matrix solving q r = a.  nullptr to only compute r, which skips the O(m^2 n) work of forming it.
 	a[m][n] is the linear system on input, and r on output
 	m, n are the sizes, for m >= n
 	*/
 	void householderQR(size_t m, size_t n, real* qt, real* a);
 
+	/*
+	replaces a[m][n] with the first n columns of q from householderQR, an orthonormal basis of its range
+	costs O(m n^2) and n reflectors of scratch, rather than the m * m qt
+	rank-deficient columns still come out orthonormal, spanning some complement
+	m >= n
+	*/
+	void orthonormalize(size_t m, size_t n, real* a);
+
 	/*
 	solves A x = b for x using Householder QR method
 	a is the matrix, sized n * n, memory stored as a[i + n * j] <- column-major
@@ -75,26 +99,91 @@ struct HouseholderQR : public DenseInverse<real> {
 	ainv size n * n
 	a and ainv can have the same memory
 	*/
-	void matrixInverse(size_t n, real* ainv, const real* a);
+	virtual void matrixInverse(size_t n, real* ainv, const real* a);
+};
+
+/*
+LU decomposition with partial pivoting, for general square systems at a third of the flops of HouseholderQR
+Algorithm 3.4.1 from Golub and Van Loan "Matrix Computations"
+*/
+template<typename real>
+struct LU : public DenseInverse<real> {
+	using Super = DenseInverse<real>;
+
+	/*
+	factors p a = l u in-place
+	a[n][n] is the matrix on input, and l below the diagonal (unit diagonal implied) and u on and above it on output
+	piv[n] is the row swapped with row k at step k
+	throws if a is singular
+	*/
+	void factor(size_t n, real* a, Index* piv);
+
+	//same as factor, but returns the column of the zero pivot for a singular a instead of throwing, or -1 on success
+	Index tryFactor(size_t n, real* a, Index* piv);
+
+	/*
+	solves a x = b for x using lu and piv from factor()
+	x and b can be the same memory
+	*/
+	void solveFactored(size_t n, real* x, const real* lu, const Index* piv, const real* b);
+
+	virtual void solveLinear(size_t n, real* x, const real* a, const real* b);
+
+	//factors once and solves for each column of the inverse
+	virtual void matrixInverse(size_t n, real* ainv, const real* a);
+};
+
+/*
+Cholesky decomposition, for Hermitian positive-definite systems at half the flops of LU
+Algorithm 4.2.1 from Golub and Van Loan "Matrix Computations"
+*/
+template<typename real>
+struct Cholesky : public DenseInverse<real> {
+	using Super = DenseInverse<real>;
+
+	/*
+	factors a = l l^H in-place
+	a[n][n] is the matrix on input, of which only the lower triangle is read, and l in the lower triangle on output
+	throws if a is not positive-definite
+	*/
+	void factor(size_t n, real* a);
+
+	/*
+	solves a x = b for x using l from factor()
+	x and b can be the same memory
+	*/
+	void solveFactored(size_t n, real* x, const real* l, const real* b);
+
+	virtual void solveLinear(size_t n, real* x, const real* a, const real* b);
+
+	//factors once and solves for each column of the inverse
+	virtual void matrixInverse(size_t n, real* ainv, const real* a);
 };
 
 }
 
 
 #include "Solver/Vector.h"
+#include "Solver/Blas.h"
 #include <string.h>	//memset
-#include <math.h>
+#include "Solver/Math.h"
 #include <cassert>
 #include <vector>
+#include <utility>	//std::swap
 
 namespace Solver {
 
 template<typename real>
 void DenseInverse<real>::backSubstituteUpperTriangular(size_t m, size_t n, real* x, const real* a, const real* const b) {
 	assert(m >= n);
-	for (int i = n-1; i >= 0; --i) {
+	if constexpr (Blas<real>::enabled) {
+		if (x != b) memcpy(x, b, sizeof(real) * n);
+		Blas<real>::trsvUpper(n, a, m, x);
+		return;
+	}
+	for (Index i = n-1; i >= 0; --i) {
 		real sum = 0;
-		for (int j = i+1; j < (int)n; ++j) {
+		for (Index j = i+1; j < (Index)n; ++j) {
 			sum += a[i+m*j] * x[j];
 		}
 		x[i] = (b[i] - sum) / a[i+m*i];
@@ -102,14 +191,30 @@ void DenseInverse<real>::backSubstituteUpperTriangular(size_t m, size_t n, real*
 }
 
 template<typename real>
-void HouseholderQR<real>::applyQ(real* a, int m, int k, int jmin, int jmax, real* v) {
-	for (int j = jmin; j < jmax; ++j) {
+void DenseInverse<real>::matrixInverse(size_t n, real* ainv, const real* a) {
+	//copy a in case ainv is the same memory
+	std::vector<real> acopy_(n * n);
+	real* acopy = acopy_.data();
+	memcpy(acopy, a, sizeof(real) * n * n);
+
+	std::vector<real> e_(n);
+	real* e = e_.data();
+	for (Index j = 0; j < (Index)n; ++j) {
+		memset((void*)e, 0, sizeof(real) * n);
+		e[j] = 1;
+		solveLinear(n, ainv + n * j, acopy, e);
+	}
+}
+
+template<typename real>
+void HouseholderQR<real>::applyQ(real* a, Index m, Index k, Index jmin, Index jmax, real* v) {
+	for (Index j = jmin; j < jmax; ++j) {
 		real vDotMj = 0;
-		for (int i = k; i < (int)m; ++i) {
-			vDotMj += v[i-k] * a[i + m * j];
+		for (Index i = k; i < (Index)m; ++i) {
+			vDotMj += ScalarTraits<real>::conj(v[i-k]) * a[i + m * j];
 		}
-		for (int i = k; i < (int)m; ++i) {
-			a[i + m * j] -= 2. * vDotMj * v[i-k];
+		for (Index i = k; i < (Index)m; ++i) {
+			a[i + m * j] -= real(2) * vDotMj * v[i-k];
 		}
 	}
 }
@@ -121,25 +226,58 @@ void HouseholderQR<real>::householderQR(size_t m, size_t n, real* qt, real* a) {
 	std::vector<real> v_(m);
 	real* v = v_.data();
 
-	for (int i = 0; i < (int)m; ++i) {
-		for (int j = 0; j < (int)m; ++j) {
-			qt[i+m*j] = i == j ? 1 : 0;
+	if (qt) {
+		for (Index i = 0; i < (Index)m; ++i) {
+			for (Index j = 0; j < (Index)m; ++j) {
+				qt[i+m*j] = i == j ? 1 : 0;
+			}
 		}
 	}
 
-	for (int k = 0; k < (int)n; ++k) {
-		//v[i-k] = a[i,k], k<=i<m
-		memcpy(v, a + k + m * k, sizeof(real) * (m - k));
-		real vLen = Vector<real>::normL2(m-k, v);
-		v[0] += vLen * (v[0] < 0 ? -1 : 1);
-		vLen = Vector<real>::normL2(m-k, v);
-		if (vLen > 1e-10) {
-			for (int i = 0; i < (int)m-k; ++i) {
-				v[i] /= vLen;
-			}
-		}
+	for (Index k = 0; k < (Index)n; ++k) {
+		reflector(v, a, m, k);
 		applyQ(a, m, k, k, n, v);
-		applyQ(qt, m, k, 0, m, v);
+		if (qt) applyQ(qt, m, k, 0, m, v);
+	}
+}
+
+template<typename real>
+void HouseholderQR<real>::reflector(real* v, const real* a, Index m, Index k) {
+	//v[i-k] = a[i,k], k<=i<m
+	memcpy(v, a + k + m * k, sizeof(real) * (m - k));
+	typename ScalarTraits<real>::Magnitude vLen = Vector<real>::normL2(m-k, v);
+	v[0] += ScalarTraits<real>::sign(v[0]) * vLen;
+	vLen = Vector<real>::normL2(m-k, v);
+	//an absolute threshold here left v unnormalized for small columns, breaking ill-conditioned / extended precision solves.
+	//if vLen is 0 then v is 0 and the reflection is a no-op.
+	if (vLen > 0) {
+		for (Index i = 0; i < m-k; ++i) {
+			v[i] /= vLen;
+		}
+	}
+}
+
+template<typename real>
+void HouseholderQR<real>::orthonormalize(size_t m, size_t n, real* a) {
+	assert(m >= n);
+
+	//vs[m-k] at vs + m * k = reflector k
+	std::vector<real> vs_(m * n);
+	real* vs = vs_.data();
+	for (Index k = 0; k < (Index)n; ++k) {
+		reflector(vs + m * k, a, m, k);
+		applyQ(a, m, k, k, n, vs + m * k);
+	}
+
+	//q = H_0 ... H_{n-1} I(:, 0:n), applied last reflector first
+	//H_k leaves columns j < k alone, they are still zero from row k down
+	for (Index j = 0; j < (Index)n; ++j) {
+		for (Index i = 0; i < (Index)m; ++i) {
+			a[i + m * j] = i == j ? 1 : 0;
+		}
+	}
+	for (Index k = n-1; k >= 0; --k) {
+		applyQ(a, m, k, k, n, vs + m * k);
 	}
 }
 
@@ -149,6 +287,17 @@ void HouseholderQR<real>::solveLinear_leastSquares(size_t m, size_t n, real* x,
 	std::vector<real> r_(m * n);
 	real* r = r_.data();
 	memcpy(r, a, sizeof(real) * m * n);
+
+	//q stays as reflectors, applied to b without forming the m * m qt
+	if constexpr (Blas<real>::enabled) {
+		std::vector<real> tau(n);
+		BlasInt info = Blas<real>::geqrf(m, n, r, m, tau.data());
+		if (info) throw Common::Exception() << "HouseholderQR: geqrf failed with info " << info;
+		std::vector<real> qtb(b, b + m);
+		Blas<real>::ormqrT(m, 1, n, r, m, tau.data(), qtb.data(), m);
+		this->backSubstituteUpperTriangular(m, n, x, r, qtb.data());
+		return;
+	}
 	
 	std::vector<real> qt_(m * m);
 	real* qt = qt_.data();
@@ -158,9 +307,9 @@ void HouseholderQR<real>::solveLinear_leastSquares(size_t m, size_t n, real* x,
 	//so I'll use an extra buffer to store the intermediate value
 	std::vector<real> qtb_(m);
 	real* qtb = qtb_.data();
-	for (int i = 0; i < (int)m; ++i) {
+	for (Index i = 0; i < (Index)m; ++i) {
 		real sum = 0;
-		for (int j = 0; j < (int)m; ++j) {
+		for (Index j = 0; j < (Index)m; ++j) {
 			sum += qt[i + m * j] * b[j];
 		}
 		qtb[i] = sum;
@@ -179,6 +328,23 @@ void HouseholderQR<real>::matrixInverse(size_t n, real* ainv, const real* a) {
 	real* r = r_.data();
 	memcpy(r, a, sizeof(real) * n * n);
 
+	//ainv = r^-1 q^T
+	if constexpr (Blas<real>::enabled) {
+		std::vector<real> tau(n);
+		BlasInt info = Blas<real>::geqrf(n, n, r, n, tau.data());
+		if (info) throw Common::Exception() << "HouseholderQR: geqrf failed with info " << info;
+		for (Index i = 0; i < (Index)n; ++i) {
+			for (Index j = 0; j < (Index)n; ++j) {
+				ainv[i+n*j] = i == j ? 1 : 0;
+			}
+		}
+		Blas<real>::ormqrT(n, n, n, r, n, tau.data(), ainv, n);
+		for (Index j = 0; j < (Index)n; ++j) {
+			Blas<real>::trsvUpper(n, r, n, ainv + n * j);
+		}
+		return;
+	}
+
 	std::vector<real> qt_(n * n);
 	real* qt = qt_.data();
 	householderQR(n, n, qt, r);
@@ -186,19 +352,19 @@ void HouseholderQR<real>::matrixInverse(size_t n, real* ainv, const real* a) {
 	std::vector<real> qty_(n);
 	real* qty = qty_.data();
 
-	for (int i = 0; i < (int)n; ++i) {
-		for (int j = 0; j < (int)n; ++j) {
+	for (Index i = 0; i < (Index)n; ++i) {
+		for (Index j = 0; j < (Index)n; ++j) {
 			ainv[i+n*j] = i == j ? 1 : 0;
 		}
 	}
-	for (int j = 0; j < (int)n; ++j) {
+	for (Index j = 0; j < (Index)n; ++j) {
 		//solve for x in a x = y
 		//let a = q r
 		//q r x = y
 		//r x = q^t y
-		for (int i = 0; i < (int)n; ++i) {
+		for (Index i = 0; i < (Index)n; ++i) {
 			real sum = 0;
-			for (int k = 0; k < (int)n; ++k) {
+			for (Index k = 0; k < (Index)n; ++k) {
 				sum = sum + qt[i + n * k] * ainv[k + n * j];
 			}
 			qty[i] = sum;
@@ -207,4 +373,177 @@ void HouseholderQR<real>::matrixInverse(size_t n, real* ainv, const real* a) {
 	}
 }
 
+template<typename real>
+void LU<real>::factor(size_t n, real* a, Index* piv) {
+	Index singularColumn = tryFactor(n, a, piv);
+	if (singularColumn >= 0) throw Common::Exception() << "LU: singular matrix, zero pivot in column " << singularColumn;
+}
+
+template<typename real>
+Index LU<real>::tryFactor(size_t n, real* a, Index* piv) {
+	if constexpr (Blas<real>::enabled) {
+		std::vector<BlasInt> ipiv(n);
+		BlasInt info = Blas<real>::getrf(n, a, n, ipiv.data());
+		if (info > 0) return (Index)info - 1;
+		//LAPACK pivots are 1-based
+		for (Index k = 0; k < (Index)n; ++k) {
+			piv[k] = (Index)ipiv[k] - 1;
+		}
+		return -1;
+	}
+	for (Index k = 0; k < (Index)n; ++k) {
+		//pivot on the largest magnitude in column k at or below the diagonal
+		Index p = k;
+		typename ScalarTraits<real>::Magnitude pAbs = ScalarTraits<real>::abs(a[k + n * k]);
+		for (Index i = k+1; i < (Index)n; ++i) {
+			typename ScalarTraits<real>::Magnitude iAbs = ScalarTraits<real>::abs(a[i + n * k]);
+			if (pAbs < iAbs) {
+				p = i;
+				pAbs = iAbs;
+			}
+		}
+		if (pAbs == 0) return k;
+		piv[k] = p;
+		if (p != k) {
+			for (Index j = 0; j < (Index)n; ++j) {
+				std::swap(a[k + n * j], a[p + n * j]);
+			}
+		}
+		//l(k+1:n, k) = a(k+1:n, k) / a(k, k), a(k+1:n, k+1:n) -= l(k+1:n, k) u(k, k+1:n)
+		for (Index i = k+1; i < (Index)n; ++i) {
+			a[i + n * k] /= a[k + n * k];
+		}
+		for (Index j = k+1; j < (Index)n; ++j) {
+			real ukj = a[k + n * j];
+			for (Index i = k+1; i < (Index)n; ++i) {
+				a[i + n * j] -= a[i + n * k] * ukj;
+			}
+		}
+	}
+	return -1;
+}
+
+template<typename real>
+void LU<real>::solveFactored(size_t n, real* x, const real* lu, const Index* piv, const real* b) {
+	if (x != b) memcpy(x, b, sizeof(real) * n);
+	if constexpr (Blas<real>::enabled) {
+		std::vector<BlasInt> ipiv(n);
+		for (Index k = 0; k < (Index)n; ++k) {
+			ipiv[k] = (BlasInt)piv[k] + 1;
+		}
+		Blas<real>::getrs(n, 1, lu, n, ipiv.data(), x, n);
+		return;
+	}
+	//x = p b
+	for (Index k = 0; k < (Index)n; ++k) {
+		if (piv[k] != k) std::swap(x[k], x[piv[k]]);
+	}
+	//x = l^-1 x
+	for (Index i = 0; i < (Index)n; ++i) {
+		real sum = x[i];
+		for (Index j = 0; j < i; ++j) {
+			sum -= lu[i + n * j] * x[j];
+		}
+		x[i] = sum;
+	}
+	//x = u^-1 x
+	this->backSubstituteUpperTriangular(n, n, x, lu, x);
+}
+
+template<typename real>
+void LU<real>::solveLinear(size_t n, real* x, const real* a, const real* b) {
+	std::vector<real> lu(a, a + n * n);
+	std::vector<Index> piv(n);
+	factor(n, lu.data(), piv.data());
+	solveFactored(n, x, lu.data(), piv.data(), b);
+}
+
+template<typename real>
+void LU<real>::matrixInverse(size_t n, real* ainv, const real* a) {
+	//copy a in case ainv is the same memory
+	std::vector<real> lu(a, a + n * n);
+	std::vector<Index> piv(n);
+	factor(n, lu.data(), piv.data());
+	for (Index j = 0; j < (Index)n; ++j) {
+		real* ainvj = ainv + n * j;
+		memset((void*)ainvj, 0, sizeof(real) * n);
+		ainvj[j] = 1;
+		solveFactored(n, ainvj, lu.data(), piv.data(), ainvj);
+	}
+}
+
+template<typename real>
+void Cholesky<real>::factor(size_t n, real* a) {
+	if constexpr (Blas<real>::enabled) {
+		BlasInt info = Blas<real>::potrf(n, a, n);
+		if (info > 0) throw Common::Exception() << "Cholesky: matrix is not positive-definite, failed at column " << (info - 1);
+		return;
+	}
+	for (Index j = 0; j < (Index)n; ++j) {
+		//l(j, j) = sqrt(a(j, j) - |l(j, 0:j)|^2)
+		typename ScalarTraits<real>::Magnitude d = ScalarTraits<real>::realPart(a[j + n * j]);
+		for (Index k = 0; k < j; ++k) {
+			d -= ScalarTraits<real>::abs2(a[j + n * k]);
+		}
+		if (!(d > 0)) throw Common::Exception() << "Cholesky: matrix is not positive-definite, failed at column " << j;
+		typename ScalarTraits<real>::Magnitude ljj = sqrt(d);
+		a[j + n * j] = ljj;
+		//l(j+1:n, j) = (a(j+1:n, j) - l(j+1:n, 0:j) l(j, 0:j)^H) / l(j, j)
+		for (Index k = 0; k < j; ++k) {
+			real ljk = ScalarTraits<real>::conj(a[j + n * k]);
+			for (Index i = j+1; i < (Index)n; ++i) {
+				a[i + n * j] -= a[i + n * k] * ljk;
+			}
+		}
+		for (Index i = j+1; i < (Index)n; ++i) {
+			a[i + n * j] /= ljj;
+		}
+	}
+}
+
+template<typename real>
+void Cholesky<real>::solveFactored(size_t n, real* x, const real* l, const real* b) {
+	if (x != b) memcpy(x, b, sizeof(real) * n);
+	if constexpr (Blas<real>::enabled) {
+		Blas<real>::potrs(n, 1, l, n, x, n);
+		return;
+	}
+	//x = l^-1 x
+	for (Index i = 0; i < (Index)n; ++i) {
+		real sum = x[i];
+		for (Index j = 0; j < i; ++j) {
+			sum -= l[i + n * j] * x[j];
+		}
+		x[i] = sum / l[i + n * i];
+	}
+	//x = l^-H x
+	for (Index i = n-1; i >= 0; --i) {
+		real sum = x[i];
+		for (Index j = i+1; j < (Index)n; ++j) {
+			sum -= ScalarTraits<real>::conj(l[j + n * i]) * x[j];
+		}
+		x[i] = sum / l[i + n * i];
+	}
+}
+
+template<typename real>
+void Cholesky<real>::solveLinear(size_t n, real* x, const real* a, const real* b) {
+	std::vector<real> l(a, a + n * n);
+	factor(n, l.data());
+	solveFactored(n, x, l.data(), b);
+}
+
+template<typename real>
+void Cholesky<real>::matrixInverse(size_t n, real* ainv, const real* a) {
+	//copy a in case ainv is the same memory
+	std::vector<real> l(a, a + n * n);
+	factor(n, l.data());
+	for (Index j = 0; j < (Index)n; ++j) {
+		real* ainvj = ainv + n * j;
+		memset((void*)ainvj, 0, sizeof(real) * n);
+		ainvj[j] = 1;
+		solveFactored(n, ainvj, l.data(), ainvj);
+	}
+}
+
 }
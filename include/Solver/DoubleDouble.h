@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Solver/Math.h"
+#include "Solver/Vector.h"
+#include <ostream>
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+double-double: an unevaluated sum hi + lo of two doubles, |lo| <= ulp(hi)/2, for ~106 bits of mantissa
+source:
+Hida, Li, Bailey (2001). "Algorithms for Quad-Double Precision Floating Point Arithmetic." ARITH-15
+Ogita, Rump, Oishi (2005). "Accurate Sum and Dot Product." SIAM Journal on Scientific Computing vol. 26 no. 6
+
+it has the exponent range of double, so it helps ill-conditioning, not overflow.
+Vector<DoubleDouble>::dot is specialized to accumulate in independent lanes, so it pipelines / vectorizes.
+*/
+struct DoubleDouble {
+	double hi, lo;
+
+	//uninitialized like double, so buffers can be memset / memcpy'd
+	DoubleDouble() = default;
+	DoubleDouble(double hi_) : hi(hi_), lo(0) {}
+	DoubleDouble(double hi_, double lo_) : hi(hi_), lo(lo_) {}
+
+	explicit operator double() const { return hi + lo; }
+	explicit operator float() const { return (float)(hi + lo); }
+
+	//s + e = a + b exactly
+	static DoubleDouble twoSum(double a, double b);
+	//same, assuming |a| >= |b|
+	static DoubleDouble quickTwoSum(double a, double b);
+	//p + e = a * b exactly
+	static DoubleDouble twoProd(double a, double b);
+
+	friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b);
+	friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b);
+	friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b);
+	friend DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b);
+	friend DoubleDouble operator-(const DoubleDouble& a) { return DoubleDouble(-a.hi, -a.lo); }
+
+	DoubleDouble& operator+=(const DoubleDouble& b) { return *this = *this + b; }
+	DoubleDouble& operator-=(const DoubleDouble& b) { return *this = *this - b; }
+	DoubleDouble& operator*=(const DoubleDouble& b) { return *this = *this * b; }
+	DoubleDouble& operator/=(const DoubleDouble& b) { return *this = *this / b; }
+
+	friend bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+	friend bool operator!=(const DoubleDouble& a, const DoubleDouble& b) { return !(a == b); }
+	friend bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+	friend bool operator>(const DoubleDouble& a, const DoubleDouble& b) { return b < a; }
+	friend bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+	friend bool operator>=(const DoubleDouble& a, const DoubleDouble& b) { return !(a < b); }
+
+	friend DoubleDouble sqrt(const DoubleDouble& a);
+	friend DoubleDouble fabs(const DoubleDouble& a) { return a.hi < 0 ? -a : a; }
+	friend bool isfinite(const DoubleDouble& a) { return std::isfinite(a.hi); }
+	friend DoubleDouble fmin(const DoubleDouble& a, const DoubleDouble& b) { return b < a ? b : a; }
+	friend DoubleDouble fmax(const DoubleDouble& a, const DoubleDouble& b) { return a < b ? b : a; }
+
+	//scientific notation to the stream's precision, up to 32 digits
+	friend std::ostream& operator<<(std::ostream& o, const DoubleDouble& a);
+};
+
+}
+
+namespace std {
+
+template<>
+struct numeric_limits<Solver::DoubleDouble> {
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = false;
+	static constexpr bool has_infinity = true;
+	static constexpr bool has_quiet_NaN = true;
+	static constexpr int digits = 106;
+	static constexpr int digits10 = 31;
+	static constexpr int max_digits10 = 33;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = numeric_limits<double>::min_exponent + 53;
+	static constexpr int max_exponent = numeric_limits<double>::max_exponent;
+	//smallest normal such that lo is still normal
+	static Solver::DoubleDouble min() noexcept { return numeric_limits<double>::min() * 9007199254740992.; }
+	static Solver::DoubleDouble max() noexcept { return Solver::DoubleDouble(numeric_limits<double>::max(), numeric_limits<double>::max() * 5.5511151231257827e-17); }
+	static Solver::DoubleDouble lowest() noexcept { return -max(); }
+	//2^-104
+	static Solver::DoubleDouble epsilon() noexcept { return 4.93038065763132e-32; }
+	static Solver::DoubleDouble infinity() noexcept { return numeric_limits<double>::infinity(); }
+	static Solver::DoubleDouble quiet_NaN() noexcept { return numeric_limits<double>::quiet_NaN(); }
+};
+
+}
+
+
+#include <cmath>
+
+namespace Solver {
+
+inline DoubleDouble DoubleDouble::twoSum(double a, double b) {
+	double s = a + b;
+	double bb = s - a;
+	return DoubleDouble(s, (a - (s - bb)) + (b - bb));
+}
+
+inline DoubleDouble DoubleDouble::quickTwoSum(double a, double b) {
+	double s = a + b;
+	return DoubleDouble(s, b - (s - a));
+}
+
+inline DoubleDouble DoubleDouble::twoProd(double a, double b) {
+	double p = a * b;
+#if defined(__FMA__) || defined(FP_FAST_FMA)
+	return DoubleDouble(p, std::fma(a, b, -p));
+#else
+	//Dekker's split, cheaper than a software fma
+	const double split = 134217729.;	//2^27 + 1
+	double t = split * a;
+	double ahi = t - (t - a);
+	double alo = a - ahi;
+	t = split * b;
+	double bhi = t - (t - b);
+	double blo = b - bhi;
+	return DoubleDouble(p, ((ahi * bhi - p) + ahi * blo + alo * bhi) + alo * blo);
+#endif
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+	DoubleDouble s = DoubleDouble::twoSum(a.hi, b.hi);
+	DoubleDouble t = DoubleDouble::twoSum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = DoubleDouble::quickTwoSum(s.hi, s.lo);
+	s.lo += t.lo;
+	return DoubleDouble::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+	return a + -b;
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+	DoubleDouble p = DoubleDouble::twoProd(a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return DoubleDouble::quickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b) {
+	double q1 = a.hi / b.hi;
+	DoubleDouble r = a - b * q1;
+	double q2 = r.hi / b.hi;
+	r -= b * q2;
+	double q3 = r.hi / b.hi;
+	return DoubleDouble::quickTwoSum(q1, q2) + q3;
+}
+
+inline DoubleDouble sqrt(const DoubleDouble& a) {
+	if (a.hi <= 0) return a.hi == 0 ? DoubleDouble(0.) : DoubleDouble(std::numeric_limits<double>::quiet_NaN());
+	if (!std::isfinite(a.hi)) return a;
+	//one Newton step from the double estimate, Karp's trick
+	double x = 1. / std::sqrt(a.hi);
+	double ax = a.hi * x;
+	DoubleDouble ax2 = DoubleDouble::twoProd(ax, ax);
+	return DoubleDouble::twoSum(ax, (a - ax2).hi * (x * .5));
+}
+
+inline std::ostream& operator<<(std::ostream& o, const DoubleDouble& a) {
+	if (!std::isfinite(a.hi)) return o << a.hi;
+	int precision = (int)o.precision();
+	if (precision <= 0) precision = 6;
+	if (precision > 32) precision = 32;
+	DoubleDouble r = fabs(a);
+	if (a.hi < 0) o << '-';
+	if (r.hi == 0) return o << "0";
+	//normalize r to [1, 10)
+	int exponent = (int)std::floor(std::log10(r.hi));
+	DoubleDouble ten(10), tenth = DoubleDouble(1) / ten;
+	for (int e = exponent; e > 0; --e) r *= tenth;
+	for (int e = exponent; e < 0; ++e) r *= ten;
+	if (r.hi >= 10) { r *= tenth; ++exponent; }
+	if (r.hi < 1) { r *= ten; --exponent; }
+	for (int i = 0; i < precision; ++i) {
+		int digit = (int)std::floor(r.hi);
+		if (digit < 0) digit = 0;
+		if (digit > 9) digit = 9;
+		o << (char)('0' + digit);
+		if (i == 0 && precision > 1) o << '.';
+		r = (r - (double)digit) * ten;
+	}
+	return o << 'e' << (exponent < 0 ? '-' : '+') << (exponent < 0 ? -exponent : exponent);
+}
+
+/*
+Dot2 of Ogita, Rump, Oishi, extended to double-double inputs:
+the hi * hi products and their sums are error-free transformations, the small cross terms are summed in plain double.
+four independent accumulators break the dependency chain so the loop pipelines / vectorizes.
+*/
+template<>
+inline DoubleDouble Vector<DoubleDouble>::dot(size_t n, const DoubleDouble* a, const DoubleDouble* b) {
+	const int lanes = 4;
+	double sum[lanes] = {};
+	double err[lanes] = {};
+	size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		for (int k = 0; k < lanes; ++k) {
+			const DoubleDouble& ai = a[i + k];
+			const DoubleDouble& bi = b[i + k];
+			DoubleDouble p = DoubleDouble::twoProd(ai.hi, bi.hi);
+			DoubleDouble s = DoubleDouble::twoSum(sum[k], p.hi);
+			sum[k] = s.hi;
+			err[k] += s.lo + p.lo + ai.hi * bi.lo + ai.lo * bi.hi;
+		}
+	}
+	for (; i < n; ++i) {
+		DoubleDouble p = DoubleDouble::twoProd(a[i].hi, b[i].hi);
+		DoubleDouble s = DoubleDouble::twoSum(sum[0], p.hi);
+		sum[0] = s.hi;
+		err[0] += s.lo + p.lo + a[i].hi * b[i].lo + a[i].lo * b[i].hi;
+	}
+	DoubleDouble result(0.);
+	for (int k = 0; k < lanes; ++k) {
+		result += DoubleDouble(sum[k]);
+		result += DoubleDouble(err[k]);
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "Solver/ScalarTraits.h"
+#include <type_traits>
+#include <exception>	//uncaught_exceptions
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+expression templates over raw vectors
+
+	auto xv = view(n, x);
+	auto pv = view(n, p);
+	xv += alpha * pv;	//one loop, no temporaries
+
+every assignment (=, +=, -=, *=) builds a deferred Assign statement.
+on its own it runs at the end of the full expression, when the temporary is destroyed.
+passed to eval(), several statements and reductions run fused in one loop:
+
+	auto rr = dot(rv, rv);
+	eval(xv += alpha * pv, rv -= alpha * Apv, rr);	//x, r, and r.r in a single pass
+	real rNormSq = rr;
+
+statements are applied in order at each index, so rr sees the updated r.
+that means fusing is only valid for element-wise statements: a statement must not read an element another statement writes at a different index.
+evalParallel(numThreads, ...) splits the loop with Parallel::getRange and runs range t on pool worker t, same as the Allocator's first touch.
+reductions are summed per-thread then combined in thread order,
+so the result depends on numThreads but is reproducible for a given numThreads.
+a dot of two views evaluated on its own, not fused with any statement, sums each thread's range with Vector<real>::dot,
+so it gets the BLAS, double-double, and split complex kernels.
+
+sizes are checked as the expression is built, and throw on a mismatch: views of different sizes, or a statement's rhs against its lhs.
+eval() checks that its statements agree before running any of them, and a statement never runs from its destructor while an exception is in flight.
+
+don't hold an Assign in a named variable: it would run when the variable goes out of scope.
+*/
+
+template<typename E>
+struct Expr {
+	const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template<typename real> struct Scalar;
+template<typename real, typename Op, typename E> struct Assign;
+
+//the size of an expression of operands of sizes a and b, where 0 = a Scalar, which matches any size.  throws if they differ.
+inline size_t matchSizes(size_t a, size_t b);
+
+struct AssignSet { template<typename T> static void apply(T& a, T b) { a = b; } };
+struct AssignAdd { template<typename T> static void apply(T& a, T b) { a += b; } };
+struct AssignSub { template<typename T> static void apply(T& a, T b) { a -= b; } };
+struct AssignMul { template<typename T> static void apply(T& a, T b) { a *= b; } };
+
+//leaf: a raw vector.  T is real or const real.
+template<typename T>
+struct VectorView : public Expr<VectorView<T>> {
+	using real = typename std::remove_const<T>::type;
+
+	T* v;
+	size_t n;
+
+	VectorView(size_t n_, T* v_) : v(v_), n(n_) {}
+	VectorView(const VectorView&) = default;
+
+	real operator[](size_t i) const { return v[i]; }
+	size_t size() const { return n; }
+
+	template<typename E> Assign<real, AssignSet, E> operator=(const Expr<E>& e) { return {v, n, e.self()}; }
+	Assign<real, AssignSet, VectorView> operator=(const VectorView& e) { return {v, n, e}; }
+	Assign<real, AssignSet, Scalar<real>> operator=(real s) { return {v, n, Scalar<real>(s)}; }
+	template<typename E> Assign<real, AssignAdd, E> operator+=(const Expr<E>& e) { return {v, n, e.self()}; }
+	template<typename E> Assign<real, AssignSub, E> operator-=(const Expr<E>& e) { return {v, n, e.self()}; }
+	template<typename E> Assign<real, AssignMul, E> operator*=(const Expr<E>& e) { return {v, n, e.self()}; }
+	Assign<real, AssignMul, Scalar<real>> operator*=(real s) { return {v, n, Scalar<real>(s)}; }
+};
+
+template<typename T> VectorView<T> view(size_t n, T* v) { return VectorView<T>(n, v); }
+
+//leaf: a constant broadcast to every index
+template<typename real_>
+struct Scalar : public Expr<Scalar<real_>> {
+	using real = real_;
+	real s;
+	explicit Scalar(real s_) : s(s_) {}
+	real operator[](size_t) const { return s; }
+	size_t size() const { return 0; }	//matches any size
+};
+
+struct OpAdd { template<typename T> static T apply(T a, T b) { return a + b; } };
+struct OpSub { template<typename T> static T apply(T a, T b) { return a - b; } };
+struct OpMul { template<typename T> static T apply(T a, T b) { return a * b; } };
+struct OpDiv { template<typename T> static T apply(T a, T b) { return a / b; } };
+
+template<typename Op, typename L, typename R>
+struct BinaryExpr : public Expr<BinaryExpr<Op, L, R>> {
+	using real = typename L::real;
+	L l;
+	R r;
+	BinaryExpr(const L& l_, const R& r_) : l(l_), r(r_) { matchSizes(l.size(), r.size()); }
+	real operator[](size_t i) const { return Op::apply(l[i], r[i]); }
+	size_t size() const { return l.size() ? l.size() : r.size(); }
+};
+
+template<typename E>
+struct NegateExpr : public Expr<NegateExpr<E>> {
+	using real = typename E::real;
+	E e;
+	NegateExpr(const E& e_) : e(e_) {}
+	real operator[](size_t i) const { return -e[i]; }
+	size_t size() const { return e.size(); }
+};
+
+template<typename L, typename R> BinaryExpr<OpAdd, L, R> operator+(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+template<typename L, typename R> BinaryExpr<OpSub, L, R> operator-(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+template<typename L, typename R> BinaryExpr<OpMul, L, R> operator*(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+template<typename E> NegateExpr<E> operator-(const Expr<E>& e) { return {e.self()}; }
+
+template<typename E> BinaryExpr<OpMul, Scalar<typename E::real>, E> operator*(typename E::real s, const Expr<E>& e) { return {Scalar<typename E::real>(s), e.self()}; }
+template<typename E> BinaryExpr<OpMul, E, Scalar<typename E::real>> operator*(const Expr<E>& e, typename E::real s) { return {e.self(), Scalar<typename E::real>(s)}; }
+template<typename E> BinaryExpr<OpDiv, E, Scalar<typename E::real>> operator/(const Expr<E>& e, typename E::real s) { return {e.self(), Scalar<typename E::real>(s)}; }
+
+/*
+statement: lhs op= rhs
+runs in its destructor unless eval() took it, or the destructor is run by stack unwinding
+throws on construction if rhs isn't size n
+*/
+template<typename real_, typename Op, typename E>
+struct Assign {
+	using real = real_;
+	static constexpr int numReductions = 0;
+
+	real* lhs;
+	size_t n;
+	E rhs;
+	bool consumed;
+	int uncaught;	//std::uncaught_exceptions() at construction
+
+	Assign(real* lhs_, size_t n_, const E& rhs_);
+	Assign(const Assign&) = delete;
+	Assign& operator=(const Assign&) = delete;
+	~Assign();
+
+	size_t size() const { return n; }
+	void consume() { consumed = true; }
+	void apply(size_t i, real*) { Op::apply(lhs[i], rhs[i]); }
+	void finish(const real*) {}
+};
+
+/*
+reduction: sum_i conj(l[i]) * r[i]
+evaluated on first conversion to real, or filled in by eval()
+*/
+template<typename L, typename R>
+struct Dot {
+	using real = typename L::real;
+	static constexpr int numReductions = 1;
+
+	L l;
+	R r;
+	real value;
+	bool evaluated;
+
+	Dot(const L& l_, const R& r_) : l(l_), r(r_), value(0), evaluated(false) { matchSizes(l.size(), r.size()); }
+
+	operator real();
+
+	size_t size() const { return l.size() ? l.size() : r.size(); }
+	void consume() {}
+	void apply(size_t i, real* acc) { *acc += ScalarTraits<real>::conj(l[i]) * r[i]; }
+	void finish(const real* acc) { value = *acc; evaluated = true; }
+};
+
+template<typename L, typename R> Dot<L, R> dot(const Expr<L>& l, const Expr<R>& r) { return {l.self(), r.self()}; }
+
+//run statements and reductions in one serial loop
+template<typename... S> void eval(S&&... stmts);
+
+//run statements and reductions in one loop split across threads.  numThreads = 0 uses the Parallel default.
+template<typename... S> void evalParallel(size_t numThreads, S&&... stmts);
+
+}
+
+
+#include "Solver/Parallel.h"
+#include "Solver/Vector.h"
+#include "Common/Exception.h"
+#include <array>
+#include <vector>
+
+namespace Solver {
+
+inline size_t matchSizes(size_t a, size_t b) {
+	if (a && b && a != b) throw Common::Exception() << "expression sizes differ: " << a << " vs " << b;
+	return a ? a : b;
+}
+
+template<typename real, typename Op, typename E>
+Assign<real, Op, E>::Assign(real* lhs_, size_t n_, const E& rhs_)
+: lhs(lhs_)
+, n(n_)
+, rhs(rhs_)
+, consumed(false)
+, uncaught(std::uncaught_exceptions())
+{
+	if (rhs.size() && rhs.size() != n) throw Common::Exception() << "assigning an expression of size " << rhs.size() << " to a vector of size " << n;
+}
+
+template<typename real, typename Op, typename E>
+Assign<real, Op, E>::~Assign() {
+	if (consumed || std::uncaught_exceptions() > uncaught) return;
+	for (size_t i = 0; i < n; ++i) {
+		Op::apply(lhs[i], rhs[i]);
+	}
+}
+
+template<typename L, typename R>
+Dot<L, R>::operator real() {
+	if (!evaluated) eval(*this);
+	return value;
+}
+
+namespace ExprDetail {
+
+template<typename real>
+inline void applyEach(size_t, real*) {}
+
+template<typename real, typename S, typename... Rest>
+inline void applyEach(size_t i, real* acc, S& stmt, Rest&... rest) {
+	stmt.apply(i, acc);
+	applyEach(i, acc + std::decay<S>::type::numReductions, rest...);
+}
+
+template<typename real>
+inline void finishEach(const real*) {}
+
+template<typename real, typename S, typename... Rest>
+inline void finishEach(const real* acc, S& stmt, Rest&... rest) {
+	stmt.finish(acc);
+	finishEach(acc + std::decay<S>::type::numReductions, rest...);
+}
+
+template<typename S, typename... Rest>
+struct First { using type = typename std::decay<S>::type; };
+
+//a thread's reduction results, on a cache line of its own so that threads don't false-share them
+template<typename real, size_t stride>
+struct alignas(64) Partial {
+	std::array<real, stride> acc;
+};
+
+//partials for up to this many threads live on the stack
+constexpr size_t maxStackThreads = 64;
+
+//a dot of two plain vectors, which Vector<real>::dot can run
+template<typename S> struct IsViewDot : public std::false_type {};
+template<typename A, typename B> struct IsViewDot<Dot<VectorView<A>, VectorView<B>>> : public std::true_type {};
+
+}
+
+template<typename... S>
+void evalParallel(size_t numThreads, S&&... stmts) {
+	using real = typename ExprDetail::First<S...>::type::real;
+	constexpr size_t numReductions = (0 + ... + std::decay<S>::type::numReductions);
+	constexpr size_t stride = numReductions ? numReductions : 1;
+	using Partial = ExprDetail::Partial<real, stride>;
+
+	//take every statement before checking, so a mismatch leaves them all unrun
+	(stmts.consume(), ...);
+	size_t n = 0;
+	for (size_t size : {stmts.size()...}) {
+		n = matchSizes(n, size);
+	}
+
+	if (!numThreads) numThreads = Parallel::getDefaultNumThreads();
+	if (numThreads > n) numThreads = n ? n : 1;
+
+	Partial stackPartials[ExprDetail::maxStackThreads];
+	std::vector<Partial> heapPartials;
+	Partial* partials = stackPartials;
+	if (numThreads > ExprDetail::maxStackThreads) {
+		heapPartials.resize(numThreads);
+		partials = heapPartials.data();
+	}
+
+	Parallel::forEach(numThreads, numThreads, [&](size_t t) {
+		size_t begin, end;
+		Parallel::getRange(n, t, numThreads, begin, end);
+		//accumulate in locals, which can't alias the statements' vectors, and store once
+		std::array<real, stride> acc;
+		acc.fill(real(0));
+		if constexpr (sizeof...(S) == 1 && (ExprDetail::IsViewDot<typename std::decay<S>::type>::value && ...)) {
+			((acc[0] = Vector<real>::dot(end - begin, stmts.l.v + begin, stmts.r.v + begin)), ...);
+		} else {
+			for (size_t i = begin; i < end; ++i) {
+				ExprDetail::applyEach(i, acc.data(), stmts...);
+			}
+		}
+		partials[t].acc = acc;
+	});
+
+	//combine in thread order
+	for (size_t t = 1; t < numThreads; ++t) {
+		for (size_t k = 0; k < numReductions; ++k) {
+			partials[0].acc[k] += partials[t].acc[k];
+		}
+	}
+	ExprDetail::finishEach(partials[0].acc.data(), stmts...);
+}
+
+template<typename... S>
+void eval(S&&... stmts) {
+	evalParallel(1, std::forward<S>(stmts)...);
+}
+
+}
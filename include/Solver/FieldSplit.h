@@ -0,0 +1,251 @@
+#pragma once
+
+#include "Solver/Krylov.h"
+#include "Solver/Preconditioner.h"
+#include "Common/Exception.h"
+#include <memory>
+#include <vector>
+
+namespace Solver {
+
+/*
+field-split / block preconditioner
+each field is an index set into the full vector, with its own inner solver for its diagonal block
+the blocks are applied matrix-free by scattering into a full vector and applying A
+
+ADDITIVE = block Jacobi
+MULTIPLICATIVE = block Gauss-Seidel, in the order the fields were added
+SCHUR = two fields, full block LDU factorization, with the Schur complement S = A11 - A10 A00^-1 A01 solved by the second field's solver
+
+the fields are expected to partition the unknowns.  unknowns not in any field are passed through unchanged.
+the inner solvers should have a fixed iteration count if the outer solver assumes a fixed preconditioner.
+
+a Preconditioner: usable as Krylov::MInv via getMInv(), which references this object, or as JFNK's preconditioner.
+*/
+template<typename real>
+struct FieldSplit : public Preconditioner<real> {
+	using Func = typename Krylov<real>::Func;
+
+	//same signature as JFNK's createLinearSolver
+	using CreateSolver = std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, Func A)>;
+
+	typedef enum {
+		ADDITIVE,
+		MULTIPLICATIVE,
+		SCHUR,
+	} type_t;
+
+	FieldSplit(size_t n, Func A, type_t type = ADDITIVE);
+
+	//the field solvers' operators point back into this object
+	FieldSplit(const FieldSplit&) = delete;
+	FieldSplit& operator=(const FieldSplit&) = delete;
+
+	/*
+	adds a field
+	indexes = which elements of the full vector belong to this field
+	createSolver = creates the inner solver for this field's block
+	for SCHUR, the second field's solver is created for the Schur complement
+	*/
+	void addField(const std::vector<size_t>& indexes, CreateSolver createSolver);
+
+	//y = MInv(x).  y and x can be the same memory
+	void operator()(real* y, const real* x);
+
+	//same as operator()
+	virtual void apply(real* y, const real* r) { (*this)(y, r); }
+
+	size_t getNumFields() const { return fields.size(); }
+	std::shared_ptr<Krylov<real>> getSolver(size_t i) const { return fields[i]->solver; }
+
+	type_t type;
+
+protected:
+	size_t n;
+	Func A;
+
+	struct Field {
+		std::vector<size_t> indexes;
+		std::vector<real> x;	//local solution
+		std::vector<real> b;	//local right hand side
+		std::shared_ptr<Krylov<real>> solver;
+	};
+	std::vector<std::shared_ptr<Field>> fields;
+
+	//full-size scratch
+	std::vector<real> fullIn;	//copy of the input, in case it is the output as well
+	std::vector<real> fullX;
+	std::vector<real> fullY;
+
+	//y = field's part of x
+	void gather(const Field& field, real* y, const real* x) const;
+
+	//y = x on field's indexes, 0 elsewhere
+	void scatter(const Field& field, real* y, const real* x) const;
+
+	//y = A_ii x for field i's diagonal block
+	void applyBlock(const Field& field, real* y, const real* x);
+
+	//y = S x for the Schur complement of the first field
+	void applySchur(real* y, const real* x);
+
+	//solves field's block for field.x with field.b as the right hand side
+	void solveField(Field& field);
+};
+
+}
+
+
+#include <string.h>	//memcpy
+#include <algorithm>
+
+namespace Solver {
+
+template<typename real>
+FieldSplit<real>::FieldSplit(size_t n_, Func A_, type_t type_)
+: type(type_)
+, n(n_)
+, A(A_)
+, fullIn(n_)
+, fullX(n_)
+, fullY(n_)
+{}
+
+template<typename real>
+void FieldSplit<real>::addField(const std::vector<size_t>& indexes, CreateSolver createSolver) {
+	auto field = std::make_shared<Field>();
+	field->indexes = indexes;
+	field->x.resize(indexes.size());
+	field->b.resize(indexes.size());
+	Field* fieldPtr = field.get();
+	Func blockA;
+	if (type == SCHUR && fields.size() == 1) {
+		blockA = [this](real* y, const real* x) { applySchur(y, x); };
+	} else {
+		blockA = [this, fieldPtr](real* y, const real* x) { applyBlock(*fieldPtr, y, x); };
+	}
+	field->solver = createSolver(indexes.size(), field->x.data(), field->b.data(), blockA);
+	fields.push_back(field);
+}
+
+template<typename real>
+void FieldSplit<real>::gather(const Field& field, real* y, const real* x) const {
+	for (Index i = 0; i < (Index)field.indexes.size(); ++i) {
+		y[i] = x[field.indexes[i]];
+	}
+}
+
+template<typename real>
+void FieldSplit<real>::scatter(const Field& field, real* y, const real* x) const {
+	memset(y, 0, sizeof(real) * n);
+	for (Index i = 0; i < (Index)field.indexes.size(); ++i) {
+		y[field.indexes[i]] = x[i];
+	}
+}
+
+template<typename real>
+void FieldSplit<real>::applyBlock(const Field& field, real* y, const real* x) {
+	scatter(field, fullX.data(), x);
+	A(fullY.data(), fullX.data());
+	gather(field, y, fullY.data());
+}
+
+/*
+S x = A11 x - A10 A00^-1 A01 x
+    = (A (P1 x - P0 z))_1 for z = A00^-1 (A P1 x)_0
+*/
+template<typename real>
+void FieldSplit<real>::applySchur(real* y, const real* x) {
+	Field& field0 = *fields[0];
+	Field& field1 = *fields[1];
+	//field0.b = A01 x
+	scatter(field1, fullX.data(), x);
+	A(fullY.data(), fullX.data());
+	gather(field0, field0.b.data(), fullY.data());
+	//field0.x = z = A00^-1 A01 x
+	solveField(field0);
+
+	scatter(field1, fullX.data(), x);
+	for (Index i = 0; i < (Index)field0.indexes.size(); ++i) {
+		fullX[field0.indexes[i]] = -field0.x[i];
+	}
+	A(fullY.data(), fullX.data());
+	gather(field1, y, fullY.data());
+}
+
+template<typename real>
+void FieldSplit<real>::solveField(Field& field) {
+	std::fill(field.x.begin(), field.x.end(), real());
+	field.solver->solve();
+}
+
+template<typename real>
+void FieldSplit<real>::operator()(real* y, const real* x) {
+	memcpy(fullIn.data(), x, sizeof(real) * n);
+	//unknowns outside of all fields pass through
+	memcpy(y, fullIn.data(), sizeof(real) * n);
+
+	if (type == ADDITIVE) {
+		for (auto& field : fields) {
+			gather(*field, field->b.data(), fullIn.data());
+			solveField(*field);
+			for (Index i = 0; i < (Index)field->indexes.size(); ++i) {
+				y[field->indexes[i]] = field->x[i];
+			}
+		}
+	} else if (type == MULTIPLICATIVE) {
+		for (auto& field : fields) {
+			for (Index i = 0; i < (Index)field->indexes.size(); ++i) {
+				y[field->indexes[i]] = 0;
+			}
+		}
+		for (auto& field : fields) {
+			//b = (x - A y)_i
+			A(fullY.data(), y);
+			for (Index i = 0; i < (Index)field->indexes.size(); ++i) {
+				size_t j = field->indexes[i];
+				field->b[i] = fullIn[j] - fullY[j];
+			}
+			solveField(*field);
+			for (Index i = 0; i < (Index)field->indexes.size(); ++i) {
+				y[field->indexes[i]] += field->x[i];
+			}
+		}
+	} else if (type == SCHUR) {
+		if (fields.size() != 2) throw Common::Exception() << "Schur field split expects two fields, found " << fields.size();
+		Field& field0 = *fields[0];
+		Field& field1 = *fields[1];
+
+		//z0 = A00^-1 x0
+		gather(field0, field0.b.data(), fullIn.data());
+		solveField(field0);
+
+		//x1' = x1 - A10 z0
+		scatter(field0, fullX.data(), field0.x.data());
+		A(fullY.data(), fullX.data());
+		for (Index i = 0; i < (Index)field1.indexes.size(); ++i) {
+			size_t j = field1.indexes[i];
+			field1.b[i] = fullIn[j] - fullY[j];
+		}
+
+		//y1 = S^-1 x1'
+		solveField(field1);
+		for (Index i = 0; i < (Index)field1.indexes.size(); ++i) {
+			y[field1.indexes[i]] = field1.x[i];
+		}
+
+		//y0 = A00^-1 (x0 - A01 y1)
+		scatter(field1, fullX.data(), field1.x.data());
+		A(fullY.data(), fullX.data());
+		for (Index i = 0; i < (Index)field0.indexes.size(); ++i) {
+			size_t j = field0.indexes[i];
+			field0.b[i] = fullIn[j] - fullY[j];
+		}
+		solveField(field0);
+		for (Index i = 0; i < (Index)field0.indexes.size(); ++i) {
+			y[field0.indexes[i]] = field0.x[i];
+		}
+	}
+}
+
+}
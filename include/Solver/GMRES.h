@@ -18,23 +18,52 @@ struct GMRES : public Krylov<real> {
 	using Super = Krylov<real>;
 
 	using Func = typename Super::Func;
+	using Magnitude = typename Super::Magnitude;
+	using Traits = ScalarTraits<real>;
 
 	GMRES(
 		size_t n,
 		real* x,
 		const real* b,
 		Func A,
-		real epsilon = 1e-7,
+		Magnitude epsilon = 1e-7,
 		int maxiter = -1,
-		int restart = -1);
+		int restart = -1,
+		std::shared_ptr<Allocator<real>> allocator = nullptr);
 	virtual ~GMRES();
 	
 	virtual void solve();
 
+	//elements of WorkspaceAllocator space solve() needs.  restart = -1 means n, same as the constructor.
+	static size_t getWorkspaceSize(size_t n, int restart = -1);
+
+	virtual size_t getMemoryFootprint() const;
+
+	//r, which every solve() starts by recomputing from x
+	virtual real* getScratch();
+
+	/*
+	optional.  default 1.
+	every this many restarts the new residual is formed as r = MInv(b - A(x)), at the cost of an A and an MInv application.
+	the other restarts form it from the Arnoldi relation instead, r = v(:, 0:i) z with z = s - h y rotated back into the basis, at the cost of an n * i update.
+	the two drift apart by rounding as cycles accumulate, hence the periodic true residual.  0 = never form the true residual.
+	worth raising when A is expensive, e.g. from a JFNK createLinearSolver factory, where every A application costs an F evaluation.
+	*/
+	int trueResidualInterval;
+
 protected:
 	size_t restart;				//how many iterations to restart.
 	
+	//the allocator the buffers came from, in case this->allocator is changed afterwards
+	std::shared_ptr<Allocator<real>> buffersAllocator;
+	virtual void allocateBuffers();
+	virtual void freeBuffers();
+
+	//allocate the buffers from the current allocator, unless they already come from it
+	void prepareBuffers();
+
 	//n = problem size, m = restart
+	//allocated on the first solve()
 	real* r;	//[n] residual
 	real* v;	//[n,m+1] linear projection
 	real* h;	//[m+1,m] lower dimensional space mapping - upper triangular matrix
@@ -42,11 +71,33 @@ protected:
 	real* sn;	//[m] sine of Givens rotations
 	real* y;	//[m+1] back-substitution of h from s
 	real* s;	//[m+1] progressively solved
-	real* w;	//[n] vHat in the paper, solved with h via elimination
+	real* w;	//[max(n,m)] vHat in the paper, solved with h via elimination.  between cycles, the dogleg's scratch.
 
-	void updateX(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, int i);
+	bool breakdown;	//whether the current cycle ended in a lucky breakdown
+
+	void updateX(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, Index i);
+	bool updateXDogleg(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, Index i, Magnitude radius, Magnitude bNormL2);
 	void genrot(real* cs, real* sn, real a, real b);
 	void rotate(real* dx, real* dy, real cs, real sn);
+
+	/*
+	z[0..i] = the least-squares residual s - h y of a cycle of i steps, in the unrotated basis v(:, 0:i)
+	= G_0^H ... G_{i-1}^H s[i] e_i, or zero after a breakdown
+	*/
+	void arnoldiResidual(Index i, real* z);
+
+	/*
+	hooks for solvers built on the same Arnoldi process
+	
+	applyOperator: y = A(x), without MInv.  used for the basis and for the restart residual.
+	arnoldiStep: w = MInv(A(v[i])) orthogonalized against v[0..i], its coefficients into h(0:i+1, i), and v[i+1] = w / |w|.
+		returns |w|, 0 on breakdown, in which case v[i+1] isn't written.
+	cycleEnd: called at the end of every restart cycle, after x is updated from the i basis vectors.
+		beta = |r| the cycle started from, h and s are rotated, cs and sn hold the rotations, y is free for scratch.
+	*/
+	virtual void applyOperator(real* y, const real* x);
+	virtual Magnitude arnoldiStep(Index i);
+	virtual void cycleEnd(Index i, Magnitude beta);
 };
 
 }
@@ -54,38 +105,96 @@ protected:
 
 #include "Solver/DenseInverse.h"
 #include "Solver/Vector.h"
-#include <math.h>
+#include "Solver/Blas.h"
+#include "Solver/Expr.h"
+#include "Solver/Math.h"
 #include <memory.h>
 #include <assert.h>
+#include <algorithm>	//std::max
 
 namespace Solver {
 
 template<typename real>
-GMRES<real>::GMRES(size_t n, real* x, const real* b, Func A, real epsilon, int maxiter, int restart_)
-: Super(n, x, b, A, epsilon, maxiter)
+GMRES<real>::GMRES(size_t n, real* x, const real* b, Func A, Magnitude epsilon, int maxiter, int restart_, std::shared_ptr<Allocator<real>> allocator)
+: Super(n, x, b, A, epsilon, maxiter, allocator)
+, trueResidualInterval(1)
 , restart(restart_)
 {
 	if (restart_ == -1) restart = n;
-	r = new real[n];
-	v = new real[n * (restart + 1)];
-	h = new real[(restart + 1) * restart];
-	cs = new real[restart];
-	sn = new real[restart];
-	y = new real[restart + 1];
-	s = new real[restart + 1];
-	w = new real[n];
+	r = v = h = cs = sn = y = s = w = nullptr;
 }
 
 template<typename real>
 GMRES<real>::~GMRES() {
-	delete[] w;
-	delete[] s;
-	delete[] y;
-	delete[] sn;
-	delete[] cs;
-	delete[] h;
-	delete[] v;
-	delete[] r;
+	freeBuffers();
+}
+
+template<typename real>
+size_t GMRES<real>::getWorkspaceSize(size_t n, int restart) {
+	size_t m = restart == -1 ? n : restart;
+	return WorkspaceAllocator<real>::getAllocationSize(n)	//r
+		+ WorkspaceAllocator<real>::getAllocationSize(std::max(n, m))	//w
+		+ WorkspaceAllocator<real>::getAllocationSize(n * (m + 1))	//v
+		+ WorkspaceAllocator<real>::getAllocationSize((m + 1) * m)	//h
+		+ WorkspaceAllocator<real>::getAllocationSize(m) * 2	//cs, sn
+		+ WorkspaceAllocator<real>::getAllocationSize(m + 1) * 2;	//y, s
+}
+
+template<typename real>
+void GMRES<real>::allocateBuffers() {
+	size_t n = this->n;
+	buffersAllocator = this->allocator ? this->allocator : Allocator<real>::getDefault();
+	r = buffersAllocator->allocate(n, "GMRES r");
+	v = buffersAllocator->allocate(n * (restart + 1), "GMRES v");
+	h = buffersAllocator->allocate((restart + 1) * restart, "GMRES h");
+	cs = buffersAllocator->allocate(restart, "GMRES cs");
+	sn = buffersAllocator->allocate(restart, "GMRES sn");
+	y = buffersAllocator->allocate(restart + 1, "GMRES y");
+	s = buffersAllocator->allocate(restart + 1, "GMRES s");
+	w = buffersAllocator->allocate(std::max(n, restart), "GMRES w");
+}
+
+template<typename real>
+void GMRES<real>::prepareBuffers() {
+	if (!buffersAllocator || buffersAllocator != (this->allocator ? this->allocator : Allocator<real>::getDefault())) {
+		freeBuffers();
+		allocateBuffers();
+	}
+}
+
+template<typename real>
+size_t GMRES<real>::getMemoryFootprint() const {
+	if (!buffersAllocator) return 0;
+	size_t n = this->n;
+	size_t m = restart;
+	return sizeof(real) * (n	//r
+		+ std::max(n, m)	//w
+		+ n * (m + 1)	//v
+		+ (m + 1) * m	//h
+		+ 2 * m	//cs, sn
+		+ 2 * (m + 1));	//y, s
+}
+
+template<typename real>
+real* GMRES<real>::getScratch() {
+	prepareBuffers();
+	return r;
+}
+
+template<typename real>
+void GMRES<real>::freeBuffers() {
+	if (!buffersAllocator) return;
+	size_t n = this->n;
+	buffersAllocator->deallocate(w, std::max(n, restart));
+	buffersAllocator->deallocate(s, restart + 1);
+	buffersAllocator->deallocate(y, restart + 1);
+	buffersAllocator->deallocate(sn, restart);
+	buffersAllocator->deallocate(cs, restart);
+	buffersAllocator->deallocate(h, (restart + 1) * restart);
+	buffersAllocator->deallocate(v, n * (restart + 1));
+	buffersAllocator->deallocate(r, n);
+	r = v = h = cs = sn = y = s = w = nullptr;
+	buffersAllocator = nullptr;
 }
 
 /*
@@ -102,20 +211,108 @@ m is restart size / h is sized (m+1) * m - m is used for determining h's element
 n is the size of v - used for linear combinations of y and v to adjust x
 */
 template<typename real>
-void GMRES<real>::updateX(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, int i) {
+void GMRES<real>::updateX(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, Index i) {
 	//y = h(1:i, 1:i) \ s(1:i)
 	DenseInverse<real>().backSubstituteUpperTriangular(m+1, i, y, h, s);
 	//x = x + v(:, 1:i) * y
-	for (int j = 0; j < i; ++j) {
-		for (int k = 0; k < (int)n; ++k) {
-			x[k] += v[k + n * j] * y[j];
+	if constexpr (Blas<real>::enabled) {
+		Blas<real>::gemv(n, i, 1, v, n, y, 1, x);
+	} else {
+		for (Index j = 0; j < i; ++j) {
+			evalParallel(this->numThreads, view(n, x) += view(n, v + n * j) * y[j]);
+		}
+	}
+}
+
+/*
+trust region version of updateX
+finds the dogleg step y within the Krylov subspace, for |y| <= radius
+since v is orthonormal, |v y| = |y|
+the Cauchy direction is the model gradient H^T s = R^T s, where R = upper i * i of the rotated h and s is the rotated s
+returns true if the step was truncated to the radius, in which case the residual is updated to the model residual of the truncated step
+*/
+template<typename real>
+bool GMRES<real>::updateXDogleg(size_t m, size_t n, real* x, real* h, real* s, real* v, real* y, Index i, Magnitude radius, Magnitude bNormL2) {
+	//y = h(1:i, 1:i) \ s(1:i)
+	DenseInverse<real>().backSubstituteUpperTriangular(m+1, i, y, h, s);
+	bool boundary = Vector<real>::normL2(i, y) > radius;
+	if (boundary) {
+		//w is free until the next cycle's arnoldiStep
+		real* g = w;
+		//g = R^H s
+		for (Index j = 0; j < i; ++j) {
+			real sum = 0;
+			for (Index k = 0; k <= j; ++k) {
+				sum += Traits::conj(h[k + (m+1) * j]) * s[k];
+			}
+			g[j] = sum;
+		}
+		//|R g|
+		Magnitude RgNormSq = 0;
+		for (Index k = 0; k < i; ++k) {
+			real sum = 0;
+			for (Index j = k; j < i; ++j) {
+				sum += h[k + (m+1) * j] * g[j];
+			}
+			RgNormSq += Traits::abs2(sum);
+		}
+		Magnitude gNormL2 = Vector<real>::normL2(i, g);
+		Magnitude RgNormL2 = sqrt(RgNormSq);
+		//Cauchy point yC = t g, minimizing |s - R t g|
+		Magnitude t = gNormL2 * gNormL2 / (RgNormL2 * RgNormL2);
+		if (t * gNormL2 >= radius) {
+			for (Index j = 0; j < i; ++j) {
+				y[j] = g[j] * radius / gNormL2;
+			}
+		} else {
+			//y = yC + tau (yN - yC), |y| = radius
+			for (Index j = 0; j < i; ++j) {
+				g[j] *= t;
+				y[j] -= g[j];
+			}
+			Magnitude tau = this->stepToRadius(i, g, y, radius);
+			for (Index j = 0; j < i; ++j) {
+				y[j] = g[j] + y[j] * tau;
+			}
 		}
+		//model residual = |s(1:i) - R y|^2 + s(i+1)^2
+		Magnitude modelResidual = Traits::abs2(s[i]);
+		for (Index k = 0; k < i; ++k) {
+			real sum = s[k];
+			for (Index j = k; j < i; ++j) {
+				sum -= h[k + (m+1) * j] * y[j];
+			}
+			modelResidual += Traits::abs2(sum);
+		}
+		this->residual = this->calcResidual(sqrt(modelResidual), bNormL2, r);
+		this->stopReason = Super::STOP_TRUST_REGION_BOUNDARY;
+	}
+	//x = x + v(:, 1:i) * y
+	for (Index j = 0; j < i; ++j) {
+		evalParallel(this->numThreads, view(n, x) += view(n, v + n * j) * y[j]);
 	}
+	return boundary;
 }
 
 template<typename real>
 void GMRES<real>::genrot(real* cs, real* sn, real a, real b) {
-	if (b == 0) {
+	if constexpr (Traits::isComplex) {
+		//[cs sn; -conj(sn) cs] [a; b] = [r; 0] with cs real
+		Magnitude aAbs = Traits::abs(a);
+		Magnitude bAbs = Traits::abs(b);
+		if (bAbs == 0) {
+			*cs = 1;
+			*sn = 0;
+		} else if (aAbs == 0) {
+			*cs = 0;
+			*sn = Traits::conj(b) / bAbs;
+		} else {
+			Magnitude scale = aAbs + bAbs;
+			Magnitude norm = scale * sqrt((aAbs / scale) * (aAbs / scale) + (bAbs / scale) * (bAbs / scale));
+			*cs = aAbs / norm;
+			*sn = (a / aAbs) * Traits::conj(b) / norm;
+		}
+	} else if (b == 0) {
 		*cs = 1;
 		*sn = 0;
 	} else if (fabs(b) > fabs(a)) {
@@ -132,10 +329,59 @@ void GMRES<real>::genrot(real* cs, real* sn, real a, real b) {
 template<typename real>
 void GMRES<real>::rotate(real* dx, real* dy, real cs, real sn) {
 	real tmp = cs * *dx + sn * *dy;
-	*dy = -sn * *dx + cs * *dy;
+	*dy = -Traits::conj(sn) * *dx + cs * *dy;
 	*dx = tmp;
 }
 
+template<typename real>
+void GMRES<real>::arnoldiResidual(Index i, real* z) {
+	for (Index k = 0; k <= i; ++k) {
+		z[k] = 0;
+	}
+	if (breakdown) return;
+	z[i] = s[i];
+	for (Index k = i-1; k >= 0; --k) {
+		real tmp = cs[k] * z[k] - sn[k] * z[k+1];
+		z[k+1] = Traits::conj(sn[k]) * z[k] + cs[k] * z[k+1];
+		z[k] = tmp;
+	}
+}
+
+template<typename real>
+void GMRES<real>::applyOperator(real* y, const real* x) {
+	this->A(y, x);
+}
+
+template<typename real>
+typename GMRES<real>::Magnitude GMRES<real>::arnoldiStep(Index i) {
+	size_t n = this->n;
+	Index m = restart;
+	//w = MInv(A(v[i]))
+	applyOperator(w, v + n * i);
+	if (this->MInv) this->MInv(w, w);
+	for (Index k = 0; k <= i; ++k) {
+		//h[k][i] = v[k]^H w
+		h[k + (m + 1) * i] = Vector<real>::dot(n, v + n * k, w);
+		//w = w - h[k][i] * v[k]
+		if constexpr (Blas<real>::enabled) {
+			Blas<real>::axpy(n, -h[k + (m + 1) * i], v + n * k, w);
+		} else {
+			evalParallel(this->numThreads, view(n, w) -= view(n, v + n * k) * h[k + (m + 1) * i]);
+		}
+	}
+	//h[i+1][i] = |w|
+	Magnitude wNormL2 = Vector<real>::normL2(n, w);
+	h[(i+1) + (m+1)*i] = wNormL2;
+	if (wNormL2 != 0) {
+		//v[i+1] = w / h[i+1][i] = w/|w|
+		evalParallel(this->numThreads, view(n, v + n * (i+1)) = view(n, w) / h[(i+1) + (m+1)*i]);
+	}
+	return wNormL2;
+}
+
+template<typename real>
+void GMRES<real>::cycleEnd(Index, Magnitude) {}
+
 /*
 sources:
 Saad, Schultz. 1986. "GMRES: A Generalized Minimal Residual Algorithm for Solving Nonsymmetric Linear Systems"
@@ -145,67 +391,71 @@ http://www.netlib.org/templates/matlab/gmres.m
 template<typename real>
 void GMRES<real>::solve() {
 	size_t n = this->n;
-	int m = restart;
+	Index m = restart;
+
+	prepareBuffers();
 
-	memset(v, 0, sizeof(real) * (m + 1) * n);
-	memset(h, 0, sizeof(real) * (m + 1) * m);
-	memset(cs, 0, sizeof(real) * m);
-	memset(sn, 0, sizeof(real) * m);
-	memset(s, 0, sizeof(real) * (m + 1));
+	memset((void*)v, 0, sizeof(real) * (m + 1) * n);
+	memset((void*)h, 0, sizeof(real) * (m + 1) * m);
+	memset((void*)cs, 0, sizeof(real) * m);
+	memset((void*)sn, 0, sizeof(real) * m);
+	memset((void*)s, 0, sizeof(real) * (m + 1));
 
 	this->iter = 0;
 
-	real bNormL2 = Vector<real>::normL2(n, this->b);
+	Magnitude bNormL2 = Vector<real>::normL2(n, this->b);
+
+	size_t numThreads = this->numThreads;
+	auto rv = view(n, r);
+	auto bv = view(n, this->b);
 
 	//r = MInv(b - A(x))
-	this->A(r, this->x);
-	for (int i = 0; i < (int)n; ++i) {
-		r[i] = this->b[i] - r[i];
-	}
+	applyOperator(r, this->x);
+	evalParallel(numThreads, rv = bv - rv);
 	if (this->MInv) this->MInv(r, r);
-	real rNormL2 = Vector<real>::normL2(n, r);
+	Magnitude rNormL2 = Vector<real>::normL2(n, r);
 
 	this->residual = this->calcResidual(rNormL2, bNormL2, r);
 	if (this->stop()) {
 	} else {
 		int done = 0;
+		int cycle = 0;
 		for (this->iter = 1; this->iter <= this->maxiter && !done;) {
-			//v[0] = r/|r|
-			for (int i = 0; i < (int)n; ++i) {
-				v[i] = r[i] / rNormL2;
+			//trust region radius remaining for this cycle's correction
+			Magnitude radius = 0;
+			if (this->trustRadius > 0) {
+				radius = this->trustRadius - Vector<real>::normL2(n, this->x);
+				if (radius <= 0) {
+					this->stopReason = Super::STOP_TRUST_REGION_BOUNDARY;
+					break;
+				}
 			}
 
+			//v[0] = r/|r|
+			evalParallel(numThreads, view(n, v) = rv / real(rNormL2));
+
 			//s = |r|*e1
-			memset(s + 1, 0, sizeof(real) * m);
+			memset((void*)(s + 1), 0, sizeof(real) * m);
 			s[0] = rNormL2;
+			breakdown = false;
 
 			//construct orthonormal basis using Gram-Schmidt
-			int i = 0;
+			Index i = 0;
 			for (; i < m; ++i, ++this->iter) {
-				//w = MInv(A(v[i]))
-				this->A(w, v + n * i);
-				if (this->MInv) this->MInv(w, w);
-				for (int k = 0; k <= i; ++k) {
-					h[k + (m + 1) * i] = Vector<real>::dot(n, w, v + n * k);
-					//w = w - h[k][i] * v[k]
-					for (int l = 0; l < (int)n; ++l) {
-						w[l] -= v[l + n * k] * h[k + (m + 1) * i];
-					}
-				}
-				//h[i+1][i] = |w|
-				real wNormL2 = Vector<real>::normL2(n, w);
+				//w = MInv(A(v[i])), orthogonalized into h and v[i+1]
+				Magnitude wNormL2 = arnoldiStep(i);
 				//if |w| = 0 then we get a '"lucky" breakdown' according to the GMRES paper
+				//the last column still needs the previous rotations for the back-substitution, and then the system is solved exactly
 				if (wNormL2 == 0) {
+					for (Index k = 0; k < i; ++k) {
+						rotate(&h[k+(m+1)*i], &h[k+1+(m+1)*i], cs[k], sn[k]);
+					}
+					breakdown = true;
 					++i;
 					break;
 				}
-				h[(i+1) + (m+1)*i] = wNormL2;
-				//v[i+1] = w / h[i+1][i] = w/|w|
-				for (int k = 0; k < (int)n; ++k) {
-					v[k + n * (i+1)] = w[k] / h[(i+1) + (m+1)*i];
-				}
 				//apply Givens rotation
-				for (int k = 0; k < i; ++k) {
+				for (Index k = 0; k < i; ++k) {
 					rotate(&h[k+(m+1)*i], &h[k+1+(m+1)*i], cs[k], sn[k]);
 				}
 				//generate plane rotation from h[i][i], h[i+1][i]
@@ -221,7 +471,7 @@ void GMRES<real>::solve() {
 #else
 				{
 					real tmp = cs[i] * s[i];
-					s[i+1] = -sn[i] * s[i];
+					s[i+1] = -Traits::conj(sn[i]) * s[i];
 					s[i] = tmp;
 				}
 #endif
@@ -238,7 +488,7 @@ void GMRES<real>::solve() {
 				h[i+1+(m+1)*i] = 0;
 #endif
 
-				this->residual = this->calcResidual(fabs(s[i+1]), bNormL2, r);
+				this->residual = this->calcResidual(Traits::abs(s[i+1]), bNormL2, r);
 				if (this->stop()) {
 					//updateX(this->x, h, s, v, y, i+1, m, n);
 #if 0
@@ -250,18 +500,40 @@ if (this->MInv) this->MInv(r, r);
 					done = 1;
 					break;
 				}
+
+				//once the least-squares step leaves the trust region, further iterations would only be truncated
+				if (this->trustRadius > 0) {
+					DenseInverse<real>().backSubstituteUpperTriangular(m+1, i+1, y, h, s);
+					if (Vector<real>::normL2(i+1, y) >= radius) {
+						++i;
+						break;
+					}
+				}
 			}
 
 			//if (done) break;
-			updateX(m, n, this->x, h, s, v, y, i);
+			if (this->trustRadius > 0) {
+				if (updateXDogleg(m, n, this->x, h, s, v, y, i, radius, bNormL2)) done = 1;
+			} else {
+				updateX(m, n, this->x, h, s, v, y, i);
+			}
+			cycleEnd(i, rNormL2);
 			if (done) break;
 
-			//r = MInv(b - A(x))
-			this->A(r, this->x);
-			for (int k = 0; k < (int)n; ++k) {
-				r[k] = this->b[k] - r[k];
+			++cycle;
+			if (trueResidualInterval > 0 && cycle % trueResidualInterval == 0) {
+				//r = MInv(b - A(x))
+				applyOperator(r, this->x);
+				evalParallel(numThreads, rv = bv - rv);
+				if (this->MInv) this->MInv(r, r);
+			} else {
+				//r = v(:, 0:i) z, with z in the y scratch
+				arnoldiResidual(i, y);
+				evalParallel(numThreads, rv = view(n, v) * y[0]);
+				for (Index j = 1; j <= i; ++j) {
+					evalParallel(numThreads, rv += view(n, v + n * j) * y[j]);
+				}
 			}
-			if (this->MInv) this->MInv(r, r);
 			rNormL2 = Vector<real>::normL2(n, r);
 			this->residual = this->calcResidual(rNormL2, bNormL2, r);
 			if (this->stop()) {
@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+index type of every loop counter, sparse row offset and column index in the library
+
+default is ptrdiff_t: signed, so reverse loops and "-1 = none" markers still work,
+and 64 bits wide on 64-bit targets, so n and nnz beyond 2^31 don't silently wrap.
+define SOLVER_INDEX32 to use int32_t instead: half the CSR index memory and bandwidth, for problems known to fit.
+it must be defined the same way for the library and everything that includes its headers.
+*/
+
+#include <stddef.h>	//ptrdiff_t
+#include <stdint.h>	//int32_t
+
+namespace Solver {
+
+#if defined(SOLVER_INDEX32)
+using Index = int32_t;
+#else
+using Index = ptrdiff_t;
+#endif
+
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Solver/GMRES.h"
+#include "Solver/DenseInverse.h"
+#include "Solver/Preconditioner.h"
 #include "Solver/Vector.h"
+#include "Solver/WorkspaceAllocator.h"
 #include <memory>
+#include <vector>
 
 namespace Solver {
 
@@ -12,12 +16,45 @@ Knoll, Keyes "Jacobian-Free Newton-Krylov Methods" 2003
 
 LinearSolver is constructed with the createLinearSolver lambda
 and must have a .solve() routine to solve for a single iteration
+
+for small n the Jacobian can instead be built explicitly with finite differences
+and LU-factored, and the factorization reused for denseJacobianRefresh steps
+
+if trustRadius is set then the line search is replaced with trust region globalization:
+Dennis, Schnabel "Numerical Methods for Unconstrained Optimization and Nonlinear Equations" 1983, Algorithm 6.4.5
+the radius is passed on to the linear solver, which is Steihaug-truncated for ConjGrad and dogleg for GMRES
+
+memory:
+JFNK holds dx and F(x), plus perturbed-state scratch allocated on the first update(): 2 n each for x and F with central differences,
+n each with forwardDifference.  forwardDifference evaluates F(x + epsilon dx) straight into the linear solver's output vector,
+so the Jacobian-vector product needs no F scratch of its own, and only the line search and the dense Jacobian build do.
+those run outside the linear solve, so with forwardDifference the F scratch is the linear solver's getScratch() vector if it has one, as GMRES does.
+with central differences all four perturbed vectors are live during the solve, so none of them can be shared.
+getMemoryFootprint() reports what JFNK and its linear solver hold, getWorkspaceSize() what JFNK needs.
+
+batched evaluation:
+if multiF is provided then the two evaluations of each Jacobian-vector product are made with one multiF call,
+and jacobianMultiply() gives k products for 2k states in one call, for residuals with a high fixed cost per evaluation.
+
+nonlinear preconditioning:
+nonlinearSmoother is a pre-smoother, i.e. nonlinear Gauss-Seidel or field-split sweeps, applied to x before each newton step
+nonlinearPreconditioner is a left preconditioner G(x) with the same roots as F(x), which newton is then applied to in place of F,
+i.e. ASPIN's G(x) = sum_i T_i(x) of subdomain corrections, T_i solving F restricted to subdomain i with the rest of x fixed.
+JFNK only applies newton to G: building G from the local nonlinear solves is up to the caller,
+and the Jacobian of G is taken matrix-free like that of F, so a preconditioner for it sees G(x).
+Cai, Keyes (2002). "Nonlinearly Preconditioned Inexact Newton Algorithms." SIAM Journal on Scientific Computing vol. 24 no. 1
+
+linear preconditioning:
+preconditioner is set up at each newton step's x and F(x) and becomes the linear solver's MInv for that step's solve
 */
 template<typename real>
 struct JFNK {
 
 	using Func = std::function<void(real* y, const real* x)>;
 
+	//ys[n * k] = F(xs[n * k]), each of the k states x_j = xs + n * j
+	using MultiFunc = std::function<void(real* ys, const real* xs, size_t k)>;
+
 	JFNK(
 		size_t n,
 		real* x,
@@ -27,9 +64,18 @@ struct JFNK {
 		std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, Func A)> createLinearSolver
 		= [](size_t n, real* x, real* b, Func A) -> std::shared_ptr<Krylov<real>> {
 			return std::make_shared<GMRES<real>>(n, x, b, A, 1e-20, 10 * n, n);
-		});
+		},
+		std::shared_ptr<Allocator<real>> allocator = nullptr);
 	virtual ~JFNK();
 
+	/*
+	elements of WorkspaceAllocator space JFNK's own vectors need
+	denseJacobian = whether the dense Jacobian will be used
+	sharedScratch = whether the linear solver has a getScratch() vector, as GMRES does, which forwardDifference without the dense Jacobian uses for its F scratch
+	the linear solver is allocated separately, through createLinearSolver, and the dense Jacobian's Index pivots live in a std::vector outside of it
+	*/
+	static size_t getWorkspaceSize(size_t n, bool denseJacobian = false, bool forwardDifference = false, bool sharedScratch = false);
+
 	/*
 	perform a single newton iteration
 	newton = newton structure
@@ -57,9 +103,52 @@ public:
 	//function which we're minimizing wrt
 	Func F;
 
+	/*
+	optional.  F of k states at once, same result as k calls to F.
+	if provided then it is used for the Jacobian-vector products in place of F.
+	not used with a nonlinearPreconditioner, which replaces F.
+	*/
+	MultiFunc multiF;
+
+	/*
+	optional.  nonlinear left preconditioner y = G(x).
+	G must share its roots with F, i.e. ASPIN's sum of subdomain corrections from local nonlinear solves.
+	if provided then newton, the Jacobian-vector products, the line search and the trust region all use G in place of F,
+	while residual, getResidual() and stopEpsilon still measure F, at one more evaluation of F per step.
+	*/
+	Func nonlinearPreconditioner;
+
+	/*
+	optional.  called at the start of each update() to improve x in-place,
+	i.e. nonlinear Gauss-Seidel sweeps or local solves of stiff subsystems (nonlinear elimination).
+	*/
+	std::function<void(real* x)> nonlinearSmoother;
+
+	/*
+	optional.  set up once per newton step that uses the linear solver, after F(x) is evaluated,
+	and then set as the linear solver's MInv, replacing any MInv it was created with.
+	clearing it puts that MInv back at the next step.
+	*/
+	std::shared_ptr<Preconditioner<real>> preconditioner;
+
 protected:
+	//y = G(x) if the nonlinearPreconditioner is provided, otherwise y = F(x)
+	void evalF(real* y, const real* x);
+
+	//ys[n * k] = evalF of each xs[n * k], with multiF when it applies
+	void evalMultiF(real* ys, const real* xs, size_t k);
+
 	void krylovLinearFunc(real* y, const real* x);
 
+public:
+	/*
+	ys[n * k] = dF/dx dxs[n * k] at the current x, k Jacobian-vector products for block or s-step linear solvers
+	the 2k perturbed states (k with forwardDifference) are evaluated with a single multiF call if it is provided
+	k > 1 allocates 4 k n elements of scratch (2 k n with forwardDifference) from the allocator on first use
+	forwardDifference differences against F(x) from the last update(), so it is only consistent during the linear solve
+	*/
+	void jacobianMultiply(real* ys, const real* dxs, size_t k);
+
 public:
 	/*
 	don't do any extra searching -- just take the full step
@@ -81,6 +170,13 @@ public:
 	//line search method
 	real (JFNK::*lineSearch)();
 
+	/*
+	accepts or rejects the full step dx based on the ratio of actual to predicted reduction of |F|^2
+	and grows or shrinks trustRadius accordingly
+	returns 1 if accepted and 0 if rejected
+	*/
+	real trustRegionStep();
+
 	//line search scalar
 	real maxAlpha;
 
@@ -90,16 +186,80 @@ public:
 	//epsilon for computing jacobian
 	real jacobianEpsilon;
 
+	/*
+	Jacobian-vector products as (F(x + epsilon dx) - F(x)) / epsilon instead of (F(x + epsilon dx) - F(x - epsilon dx)) / (2 epsilon)
+	half the F evaluations and half the perturbed-state scratch, for first-order rather than second-order accuracy in epsilon.
+	default false.  set before the first update(), which sizes the scratch.
+	*/
+	bool forwardDifference;
+
+	//threads for JFNK's own vector updates, as Krylov::numThreads is for the linear solver's.  default 1.
+	size_t numThreads;
+
 	//stop epsilon
 	real stopEpsilon;
 
 	//stop max iter
 	int maxiter;
 
+	//trust region radius.  default 0 = disabled, use the line search.
+	real trustRadius;
+
+	//stop once rejected steps have shrunk the trust region below this
+	real trustRadiusMin;
+
+	//maximum the trust region can grow to
+	real trustRadiusMax;
+
+	//minimum ratio of actual to predicted reduction to accept a step
+	real trustRegionEta;
+
+	/*
+	if n <= denseJacobianMaxN then the Jacobian is built with n forward-difference evaluations of F
+	and LU-factored, instead of solving for dx with the linear solver
+	default 0 = always use the linear solver
+	if the Jacobian turns out singular then that step and all later ones use the linear solver,
+	so a singular problem pays for the dense build once rather than every step
+	*/
+	size_t denseJacobianMaxN;
+
+	/*
+	how many newton steps to reuse the dense Jacobian factorization for
+	1 = newton, 0 = chord (never rebuild), k > 1 = Shamanskii
+	a stale Jacobian is always rebuilt if its step fails the line search
+	*/
+	int denseJacobianRefresh;
+
+	bool useDenseJacobian() const { return n <= denseJacobianMaxN && !denseJacobianSingular; }
+
+	//whether a singular dense Jacobian switched the remaining steps to the linear solver
+	bool getDenseJacobianSingular() const { return denseJacobianSingular; }
+
+	//how many times the dense Jacobian has been built
+	int getDenseJacobianBuilds() const { return denseJacobianBuilds; }
+
 protected:
 	virtual real calcResidual(const real* x, real alpha) const;
 	
 	real residualAtAlpha(real alpha);
+
+	/*
+	build the dense Jacobian at x, with F_of_x already evaluated, and store its LU factorization
+	returns false if the Jacobian is singular
+	*/
+	bool buildDenseJacobian();
+
+	//solve dF/dx dx = F for dx with either the dense Jacobian or the linear solver
+	void solveForDx(bool forceRebuild);
+
+	/*
+	solve for dx using the dense Jacobian factorization, rebuilding it if it is stale or forceRebuild is set
+	returns false if the Jacobian is singular, in which case dx is left untouched
+	*/
+	bool solveDenseJacobian(bool forceRebuild);
+
+	//source of the buffers below.  default Allocator::getDefault().  must not be changed after construction.
+	std::shared_ptr<Allocator<real>> allocator;
 	
 	//step to solve (df/du)^-1 * du via GMRES
 	real* dx;
@@ -107,18 +267,56 @@ protected:
 	//function value at that point
 	real* F_of_x;
 	
-	//temporary buffers
+	//temporary buffers, sized by allocateScratch() for the difference mode
+	//x_minus_dx follows x_plus_dx in the same allocation, likewise for F, so a Jacobian-vector product is one batch of 2 states
+	//with forwardDifference there are no minus buffers and x_minus_dx, F_of_x_minus_dx are nullptr
+	Buffer<real> perturbedX;
+	Buffer<real> perturbedF;
+
 	real* x_plus_dx;
 	real* F_of_x_plus_dx;
 
 	real* x_minus_dx;
 	real* F_of_x_minus_dx;
 
+	//size perturbedX and perturbedF for the difference mode and point the temporary buffers into them, or F_of_x_plus_dx into the linear solver's scratch
+	void allocateScratch();
+
+	//[2 n k] states and F values for jacobianMultiply with k > 1, allocated on first use
+	Buffer<real> multiStates;
+	Buffer<real> multiFs;
+
+	//[n*n] column-major LU factors of the dense Jacobian and their [n] pivots, allocated on first use
+	Buffer<real> jacobianLU;
+	std::vector<Index> jacobianPivots;
+
+	//how many steps the current jacobianLU has been used for
+	int jacobianAge;
+
+	bool denseJacobianSingular;
+	int denseJacobianBuilds;
+
+	/*
+	|F - dF/dx dx| of the last solveForDx, used as the trust region model residual
+	unpreconditioned, at the cost of one more Jacobian-vector product when the linear solver has an MInv
+	*/
+	real modelResidual;
+
+	//whether the preconditioner still has to be set up at the current x
+	bool preconditionerStale;
+
+	//whether linearSolver->MInv is the preconditioner's, and the MInv it replaced
+	bool preconditionerInstalled;
+	Func linearSolverMInv;
+
 public:
 	real getResidual() const { return residual; }
 	real getAlpha() const { return alpha; }
 	int getIter() const { return iter; }
 	std::shared_ptr<Krylov<real>> getLinearSolver() const { return linearSolver; }
+
+	//bytes of the vectors JFNK and its linear solver currently hold
+	size_t getMemoryFootprint() const;
 protected:
 	//residual of best solution along the line search
 	real residual;
@@ -139,9 +337,11 @@ public:
 
 
 #include "Solver/Vector.h"
+#include "Solver/Expr.h"
 #include <limits>
+#include <algorithm>
 #include <string.h>	//memcpy
-#include <cmath>	//isfinite
+#include "Solver/Math.h"
 #include <assert.h>
 
 namespace Solver {
@@ -153,7 +353,8 @@ JFNK<real>::JFNK(
 	Func F_,
 	real stopEpsilon_,
 	int maxiter_,
-	std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, Func linearFunc)> createLinearSolver)
+	std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, Func linearFunc)> createLinearSolver,
+	std::shared_ptr<Allocator<real>> allocator_)
 : n(n_)
 , x(x_)
 , F(F_)
@@ -161,14 +362,34 @@ JFNK<real>::JFNK(
 , maxAlpha(1)
 , lineSearchMaxIter(20)
 , jacobianEpsilon(1e-6)
+, forwardDifference(false)
+, numThreads(1)
 , stopEpsilon(stopEpsilon_)
 , maxiter(maxiter_)
-, dx(new real[n])
-, F_of_x(new real[n])
-, x_plus_dx(new real[n])
-, F_of_x_plus_dx(new real[n])
-, x_minus_dx(new real[n])
-, F_of_x_minus_dx(new real[n])
+, trustRadius(0)
+, trustRadiusMin(std::numeric_limits<real>::epsilon())
+, trustRadiusMax(std::numeric_limits<real>::max())
+, trustRegionEta(1e-4)
+, denseJacobianMaxN(0)
+, denseJacobianRefresh(1)
+, allocator(allocator_ ? allocator_ : Allocator<real>::getDefault())
+, dx(allocator->allocate(n, "JFNK dx"))
+, F_of_x(allocator->allocate(n, "JFNK F_of_x"))
+, perturbedX(allocator, 0, "JFNK x_plus_dx")
+, perturbedF(allocator, 0, "JFNK F_of_x_plus_dx")
+, x_plus_dx(nullptr)
+, F_of_x_plus_dx(nullptr)
+, x_minus_dx(nullptr)
+, F_of_x_minus_dx(nullptr)
+, multiStates(allocator, 0, "JFNK multiStates")
+, multiFs(allocator, 0, "JFNK multiFs")
+, jacobianLU(allocator, 0, "JFNK jacobianLU")
+, jacobianAge(0)
+, denseJacobianSingular(false)
+, denseJacobianBuilds(0)
+, modelResidual(0)
+, preconditionerStale(true)
+, preconditionerInstalled(false)
 , residual(0)
 , alpha(0)
 , iter(0)
@@ -183,12 +404,62 @@ JFNK<real>::JFNK(
 
 template<typename real>
 JFNK<real>::~JFNK() {
-	delete[] dx;
-	delete[] F_of_x;
-	delete[] x_plus_dx;
-	delete[] F_of_x_plus_dx;
-	delete[] x_minus_dx;
-	delete[] F_of_x_minus_dx;
+	allocator->deallocate(dx, n);
+	allocator->deallocate(F_of_x, n);
+}
+
+template<typename real>
+size_t JFNK<real>::getWorkspaceSize(size_t n, bool denseJacobian, bool forwardDifference, bool sharedScratch) {
+	size_t perturbedSize = WorkspaceAllocator<real>::getAllocationSize(forwardDifference ? n : 2 * n);
+	bool shareF = forwardDifference && !denseJacobian && sharedScratch;
+	return WorkspaceAllocator<real>::getAllocationSize(n) * 2
+		+ perturbedSize * (shareF ? 1 : 2)
+		+ (denseJacobian ? WorkspaceAllocator<real>::getAllocationSize(n * n) : 0);
+}
+
+template<typename real>
+size_t JFNK<real>::getMemoryFootprint() const {
+	return sizeof(real) * (2 * n	//dx, F_of_x
+		+ perturbedX.size()
+		+ perturbedF.size()
+		+ jacobianLU.size()
+		+ multiStates.size()
+		+ multiFs.size())
+		+ sizeof(Index) * jacobianPivots.size()
+		+ linearSolver->getMemoryFootprint();
+}
+
+template<typename real>
+void JFNK<real>::allocateScratch() {
+	size_t size = forwardDifference ? n : 2 * n;
+	//not while the dense Jacobian may be used, which would have the linear solver allocate buffers it doesn't need
+	real* sharedF = forwardDifference && !useDenseJacobian() ? linearSolver->getScratch() : nullptr;
+	perturbedX.resize(size);
+	perturbedF.resize(sharedF ? 0 : size);
+	x_plus_dx = perturbedX.data();
+	F_of_x_plus_dx = sharedF ? sharedF : perturbedF.data();
+	x_minus_dx = forwardDifference ? nullptr : x_plus_dx + n;
+	F_of_x_minus_dx = forwardDifference ? nullptr : F_of_x_plus_dx + n;
+}
+
+template<typename real>
+void JFNK<real>::evalF(real* y, const real* x) {
+	if (nonlinearPreconditioner) {
+		nonlinearPreconditioner(y, x);
+	} else {
+		F(y, x);
+	}
+}
+
+template<typename real>
+void JFNK<real>::evalMultiF(real* ys, const real* xs, size_t k) {
+	if (multiF && !nonlinearPreconditioner) {
+		multiF(ys, xs, k);
+	} else {
+		for (Index j = 0; j < (Index)k; ++j) {
+			evalF(ys + n * j, xs + n * j);
+		}
+	}
 }
 
 //solve dF(x[n])/dx[n] x = F(x[n]) for x
@@ -209,13 +480,22 @@ void JFNK<real>::krylovLinearFunc(real* y, const real* dx) {
 	real epsilon = jacobianEpsilon;
 #endif
 
-	for (int i = 0; i < (int)n; ++i) {
-		x_plus_dx[i] = x[i] + dx[i] * epsilon;
-		x_minus_dx[i] = x[i] - dx[i] * epsilon;
+	auto xv = view(n, x);
+	auto dxv = view(n, dx);
+	auto yv = view(n, y);
+
+	if (forwardDifference) {
+		//y = (F(x + dx * epsilon) - F(x)) / epsilon, with F evaluated into y itself
+		evalParallel(numThreads, view(n, x_plus_dx) = xv + dxv * epsilon);
+		evalF(y, x_plus_dx);
+		evalParallel(numThreads, yv = (yv - view(n, F_of_x)) / epsilon);
+		return;
 	}
+
+	evalParallel(numThreads, view(n, x_plus_dx) = xv + dxv * epsilon, view(n, x_minus_dx) = xv - dxv * epsilon);
 	
-	F(F_of_x_plus_dx, x_plus_dx);	//F(x + dx * epsilon)
-	F(F_of_x_minus_dx, x_minus_dx);	//F(x - dx * epsilon)
+	//F(x + dx * epsilon), F(x - dx * epsilon)
+	evalMultiF(F_of_x_plus_dx, x_plus_dx, 2);
 
 	/*
 	Knoll, Keyes "Jacobian-Free JFNK-Krylov Methods" 2003 
@@ -230,8 +510,44 @@ void JFNK<real>::krylovLinearFunc(real* y, const real* dx) {
 	
 	//TODO shouldn't this be divided by epsilon times |dx| ?
 	//(F(x + dx * epsilon) - F(x - dx * epsilon)) / (2 * |dx| * epsilon)
-	for (int i = 0; i < (int)n; ++i) {
-		y[i] = (F_of_x_plus_dx[i] - F_of_x_minus_dx[i]) / denom;		//F(x + dx * epsilon) - F(x - dx * epsilon)
+	evalParallel(numThreads, yv = (view(n, F_of_x_plus_dx) - view(n, F_of_x_minus_dx)) / denom);		//F(x + dx * epsilon) - F(x - dx * epsilon)
+}
+
+template<typename real>
+void JFNK<real>::jacobianMultiply(real* ys, const real* dxs, size_t k) {
+	allocateScratch();
+	if (k == 1) {
+		krylovLinearFunc(ys, dxs);
+		return;
+	}
+	//perturbed states per product
+	Index p = forwardDifference ? 1 : 2;
+	multiStates.resize(p * n * k);
+	multiFs.resize(p * n * k);
+	real* states = multiStates.data();
+	real* Fs = multiFs.data();
+
+	//states = x + epsilon dx_0, x - epsilon dx_0, x + epsilon dx_1, ... or without the minus states for forwardDifference
+	real epsilon = jacobianEpsilon;
+	for (Index j = 0; j < (Index)k; ++j) {
+		const real* dx = dxs + n * j;
+		real* plus = states + n * (p * j);
+		evalParallel(numThreads, view(n, plus) = view(n, x) + view(n, dx) * epsilon);
+		if (!forwardDifference) {
+			real* minus = plus + n;
+			evalParallel(numThreads, view(n, minus) = view(n, x) - view(n, dx) * epsilon);
+		}
+	}
+
+	evalMultiF(Fs, states, p * k);
+
+	//same differences as krylovLinearFunc
+	real denom = forwardDifference ? epsilon : 2. * epsilon;
+	for (Index j = 0; j < (Index)k; ++j) {
+		real* y = ys + n * j;
+		const real* Fplus = Fs + n * (p * j);
+		const real* Fminus = forwardDifference ? F_of_x : Fplus + n;
+		evalParallel(numThreads, view(n, y) = (view(n, Fplus) - view(n, Fminus)) / denom);
 	}
 }
 
@@ -244,18 +560,16 @@ template<typename real>
 real JFNK<real>::residualAtAlpha(real alpha) {
 	
 	//advance by fraction along dx
-	for (int i = 0; i < (int)n; ++i) {
-		x_plus_dx[i] = x[i] - dx[i] * alpha;
-	}
+	evalParallel(numThreads, view(n, x_plus_dx) = view(n, x) - view(n, dx) * alpha);
 	
 	//calculate residual at x
-	F(F_of_x_plus_dx, x_plus_dx);
+	evalF(F_of_x_plus_dx, x_plus_dx);
 	
 	//divide by n to normalize, so errors remain the same despite vector size
 	real stepResidual = calcResidual(F_of_x_plus_dx, alpha);
 	
 	//for comparison's sake, convert nans to flt_max's
-	//this will still fail the std::isfinite() conditions, *and* it will correctly compare when searching for minimas
+	//this will still fail the isfinite() conditions, *and* it will correctly compare when searching for minimas
 	if (stepResidual != stepResidual) stepResidual = std::numeric_limits<real>::max();
 
 	return stepResidual;
@@ -316,26 +630,156 @@ real JFNK<real>::lineSearch_bisect() {
 	return residualL < residualR ? alphaL : alphaR;
 }
 
+template<typename real>
+bool JFNK<real>::buildDenseJacobian() {
+	++denseJacobianBuilds;
+	jacobianLU.resize(n * n);
+	jacobianPivots.resize(n);
+	real* jacobian = jacobianLU.data();
+
+	//column j = (F(x + epsilon e_j) - F(x)) / epsilon
+	real epsilon = jacobianEpsilon;
+	memcpy(x_plus_dx, x, sizeof(real) * n);
+	for (Index j = 0; j < (Index)n; ++j) {
+		x_plus_dx[j] = x[j] + epsilon;
+		evalF(F_of_x_plus_dx, x_plus_dx);
+		x_plus_dx[j] = x[j];
+		evalParallel(numThreads, view(n, jacobian + n * j) = (view(n, F_of_x_plus_dx) - view(n, F_of_x)) / epsilon);
+	}
+
+	//factor in-place
+	jacobianAge = 0;
+	bool singular = LU<real>().tryFactor(n, jacobian, jacobianPivots.data()) >= 0;
+	for (Index i = 0; !singular && i < (Index)(n * n); ++i) {
+		if (!isfinite(jacobian[i])) singular = true;
+	}
+	if (singular) {
+		jacobianLU.clear();
+		jacobianPivots.clear();
+		denseJacobianSingular = true;
+		return false;
+	}
+	return true;
+}
+
+template<typename real>
+bool JFNK<real>::solveDenseJacobian(bool forceRebuild) {
+	if (forceRebuild
+		|| jacobianLU.empty()
+		|| (denseJacobianRefresh > 0 && jacobianAge >= denseJacobianRefresh)
+	) {
+		if (!buildDenseJacobian()) return false;
+	}
+	++jacobianAge;
+
+	//dx = (dF/dx)^-1 F(x)
+	LU<real>().solveFactored(n, dx, jacobianLU.data(), jacobianPivots.data(), F_of_x);
+	return true;
+}
+
+template<typename real>
+void JFNK<real>::solveForDx(bool forceRebuild) {
+	//the trust region step is measured from the origin
+	if (trustRadius > 0) memset(dx, 0, sizeof(real) * n);
+	linearSolver->trustRadius = trustRadius;
+
+	//fall back on the linear solver if the dense Jacobian is singular
+	if (useDenseJacobian() && solveDenseJacobian(forceRebuild)) {
+		modelResidual = 0;
+	} else {
+		if (preconditioner && preconditionerStale) {
+			preconditioner->setup(x, F_of_x);
+			if (!preconditionerInstalled) linearSolverMInv = linearSolver->MInv;
+			linearSolver->MInv = preconditioner->getMInv();
+			preconditionerInstalled = true;
+			preconditionerStale = false;
+		} else if (!preconditioner && preconditionerInstalled) {
+			//don't leave the solver calling into a preconditioner that was cleared, and maybe destroyed
+			linearSolver->MInv = linearSolverMInv;
+			linearSolverMInv = nullptr;
+			preconditionerInstalled = false;
+		}
+		linearSolver->solve();
+		if (trustRadius > 0 && linearSolver->MInv) {
+			//a preconditioned solver's residual can be |MInv (F - J dx)|, so measure |F - J dx| itself for comparing against |F|
+			krylovLinearFunc(F_of_x_plus_dx, dx);
+			auto rv = view(n, F_of_x_plus_dx);
+			auto rr = dot(rv, rv);
+			evalParallel(numThreads, rv = view(n, F_of_x) - rv, rr);
+			modelResidual = sqrt((real)rr);
+		} else {
+			modelResidual = linearSolver->getResidual();
+		}
+	}
+}
+
+template<typename real>
+real JFNK<real>::trustRegionStep() {
+	real FNormL2 = Vector<real>::normL2(n, F_of_x);
+	real dxNormL2 = Vector<real>::normL2(n, dx);
+
+	//truncate steps from solvers that don't honor the trust radius
+	//|F - J s dx| <= (1 - s) |F| + s |F - J dx|
+	if (dxNormL2 > trustRadius) {
+		real scale = trustRadius / dxNormL2;
+		evalParallel(numThreads, view(n, dx) *= scale);
+		modelResidual = (1. - scale) * FNormL2 + scale * modelResidual;
+		dxNormL2 = trustRadius;
+	}
+
+	real stepResidual = residualAtAlpha(1);
+	real FNewNormL2 = Vector<real>::normL2(n, F_of_x_plus_dx);
+	real actualReduction = FNormL2 * FNormL2 - FNewNormL2 * FNewNormL2;
+	real predictedReduction = FNormL2 * FNormL2 - modelResidual * modelResidual;
+	real ratio = predictedReduction > 0 ? actualReduction / predictedReduction : -1;
+
+	//written to shrink on nan
+	if (!(ratio >= .25)) {
+		trustRadius = .25 * dxNormL2;
+	} else if (ratio > .75 && dxNormL2 >= .99 * trustRadius) {
+		trustRadius = std::min<real>(2. * trustRadius, trustRadiusMax);
+	}
+
+	if (ratio > trustRegionEta) {
+		residual = stepResidual;
+		return 1;
+	}
+	residual = calcResidual(F_of_x, 0);
+	return 0;
+}
+
 /*
 performs update of iteration x[n+1] = x[n] - ||dF/dx||^-1 F(x[n])
 */
 template<typename real>
 void JFNK<real>::update() {	
 
+	allocateScratch();
+
+	if (nonlinearSmoother) nonlinearSmoother(x);
+
 	//first calc F(x[n])
-	F(F_of_x, x);	
+	evalF(F_of_x, x);	
+	preconditionerStale = true;
 
 	//solve dF(x[n])/dx[n] dx[n] = F(x[n]) for dx[n]
 	//treating dF(x[n])/dx[n] = I gives us the (working) explicit version
-	linearSolver->solve();
+	solveForDx(false);
 
 //the next step in matching the implicit to the explicit (whose results are good) is making sure the line search is going the correct distance 
 	//update x[n] = x[n] - alpha * dx[n] for some alpha
-	alpha = (this->*lineSearch)();
+	bool useTrustRegion = trustRadius > 0;
+	alpha = useTrustRegion ? trustRegionStep() : (this->*lineSearch)();
+
+	//if a reused Jacobian gave a bad step then rebuild it and try again
+	if (alpha == 0 && useDenseJacobian() && jacobianAge > 1) {
+		solveForDx(true);
+		alpha = useTrustRegion ? trustRegionStep() : (this->*lineSearch)();
+	}
 
-	if (!alpha) {
+	if (alpha == 0) {
 		//fail code? one will be set in the sim_t calling function at least.
-	} else if (!std::isfinite(residual)) {
+	} else if (!isfinite(residual)) {
 		//fail code as well?  likewise, one will be set in the caller.
 	} else {
 
@@ -343,9 +787,13 @@ void JFNK<real>::update() {
 		//if (private->alpha == 0) errorStr("stuck"); 
 
 		//set x[n+1] = x[n] - alpha * dx[n]
-		for (int i = 0; i < (int)n; ++i) {
-			x[i] -= dx[i] * alpha;
-		}
+		evalParallel(numThreads, view(n, x) -= view(n, dx) * alpha);
+	}
+
+	//the line search measured G, but convergence is judged on F
+	if (nonlinearPreconditioner) {
+		F(F_of_x_plus_dx, x);
+		residual = calcResidual(F_of_x_plus_dx, alpha);
 	}
 }
 
@@ -354,8 +802,9 @@ void JFNK<real>::solve() {
 	for (; iter < maxiter; ++iter) {
 		update();
 		if (stopCallback && stopCallback()) break;
-		if (!alpha) break;
-		if (!std::isfinite(residual)) break;
+		//a rejected trust region step retries with a smaller radius
+		if (alpha == 0 && !(trustRadius > trustRadiusMin)) break;
+		if (!isfinite(residual)) break;
 		if (residual < stopEpsilon) break;
 	}
 }
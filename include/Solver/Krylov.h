@@ -1,6 +1,10 @@
 #pragma once
 
+#include "Solver/Index.h"
+#include "Solver/ScalarTraits.h"
+#include "Solver/WorkspaceAllocator.h"
 #include <functional>
+#include <memory>
 
 namespace Solver {
 
@@ -12,8 +16,15 @@ struct Krylov {
 	stores result in y
 	*/
 	using Func = std::function<void(real* y, const real* x)>;
+
+	//real type of norms and tolerances.  real itself, or T for std::complex<T>.
+	using Magnitude = typename ScalarTraits<real>::Magnitude;
 	
-	Krylov(size_t n, real* x, const real* b, Func A, real epsilon_ = 1e-7, int maxiter = -1);
+	/*
+	allocator = source of the internal buffers, default Allocator::getDefault().
+	pass a WorkspaceAllocator to have the solver work in caller-provided memory, sized by the solver's getWorkspaceSize().
+	*/
+	Krylov(size_t n, real* x, const real* b, Func A, Magnitude epsilon_ = 1e-7, int maxiter = -1, std::shared_ptr<Allocator<real>> allocator = nullptr);
 	virtual ~Krylov();
 	
 	virtual void solve() = 0;
@@ -29,11 +40,36 @@ public:
 
 	std::function<bool()> stopCallback;
 
-	real epsilon;							//optional.  default 1e-10
+	Magnitude epsilon;						//optional.  default 1e-10
 	int maxiter;							//optional.  default 'n'
 
+	/*
+	optional.  default 0 = disabled.
+	if positive then x is kept within this L2 radius of the origin:
+	ConjGrad uses Steihaug truncation, GMRES uses a dogleg within its Krylov subspace,
+	and both stop once the step reaches the boundary.
+	other solvers ignore it.
+	x should be zero initially.
+	*/
+	Magnitude trustRadius;
+
+	//optional.  default Allocator::getDefault().  source of the solver's internal buffers.
+	std::shared_ptr<Allocator<real>> allocator;
+
+	//optional.  default 1.  threads for the solver's own vector updates, where they are written with Solver/Expr.h.  0 = Parallel default.
+	size_t numThreads;
+
 	int getIter() const { return iter; }
-	real getResidual() const { return residual; }
+	Magnitude getResidual() const { return residual; }
+
+	//bytes of the buffers the solver holds between solve() calls.  default 0, for solvers that only allocate inside solve().
+	virtual size_t getMemoryFootprint() const;
+
+	/*
+	an n-vector the solver holds but only uses inside solve(), for the caller to use as scratch in between.  default nullptr, none.
+	allocates the solver's buffers if they aren't yet.  every solve() overwrites it.
+	*/
+	virtual real* getScratch();
 
 public:
 	typedef enum {
@@ -42,20 +78,22 @@ public:
 		STOP_RESIDUAL_NOT_FINITE,
 		STOP_RESIDUAL_WITHIN_EPSILON,
 		STOP_REACHED_MAXITER,
+		STOP_TRUST_REGION_BOUNDARY,
+		STOP_BREAKDOWN,		//a recurrence divisor vanished, the solver can't continue from this x
 	} stopReason_t;
 	stopReason_t stopReason;
 
 protected:	
 	//member variables
 	int iter;								//current iteration
-	real residual;						//current residual
+	Magnitude residual;					//current residual
 
 	/*
 	returns the residual scalar value
 	r = residual
 	b = solution vector
 	*/
-	virtual real calcResidual(real rNormL2, real bNormL2, const real* r);
+	virtual Magnitude calcResidual(Magnitude rNormL2, Magnitude bNormL2, const real* r);
 	
 	/*
 	determines whether to stop
@@ -63,12 +101,19 @@ protected:
 	returns false to keep going, true to stop
 	*/
 	virtual bool stop();
+
+	/*
+	returns the positive tau for which |x + tau p| = radius
+	x and p are size n, |x| <= radius
+	*/
+	static Magnitude stepToRadius(size_t n, const real* x, const real* p, Magnitude radius);
 };
 
 }
 
 
-#include <cmath>	//isfinite
+#include "Solver/Vector.h"
+#include "Solver/Math.h"
 
 namespace Solver {
 
@@ -80,14 +125,19 @@ n = problem size
 after krylov_init, the caller is still expected to provide x, b, A, and override any other paramters
 */
 template<typename real>
-Krylov<real>::Krylov(size_t n_, real* x_, const real* b_, Func A_, real epsilon_, int maxiter_)
+Krylov<real>::Krylov(size_t n_, real* x_, const real* b_, Func A_, Magnitude epsilon_, int maxiter_, std::shared_ptr<Allocator<real>> allocator_)
 : n(n_)
 , x(x_)
 , b(b_)
 , A(A_)
 , epsilon(epsilon_)
 , maxiter(maxiter_)
+, trustRadius(0)
+, allocator(allocator_ ? allocator_ : Allocator<real>::getDefault())
+, numThreads(1)
 , stopReason(NOT_STOPPED)
+, iter(0)
+, residual(0)
 {
 	if (maxiter == -1) maxiter = n;
 }
@@ -95,9 +145,19 @@ Krylov<real>::Krylov(size_t n_, real* x_, const real* b_, Func A_, real epsilon_
 template<typename real>
 Krylov<real>::~Krylov() {}
 
+template<typename real>
+size_t Krylov<real>::getMemoryFootprint() const {
+	return 0;
+}
+
+template<typename real>
+real* Krylov<real>::getScratch() {
+	return nullptr;
+}
+
 
 template<typename real>
-real Krylov<real>::calcResidual(real rNormL2, real bNormL2, const real* r) {
+typename Krylov<real>::Magnitude Krylov<real>::calcResidual(Magnitude rNormL2, Magnitude bNormL2, const real* r) {
 	return rNormL2;
 	//most implementations I see rely on L2 norms
 	//return bNormL2 == 0 ? rNormL2 : rNormL2 / bNormL2;
@@ -113,7 +173,7 @@ bool Krylov<real>::stop() {
 		stopReason = STOP_CALLBACK;
 		return true;
 	}
-	if (!std::isfinite(residual)) {
+	if (!isfinite(residual)) {
 		stopReason = STOP_RESIDUAL_NOT_FINITE;
 		return true;
 	}
@@ -128,4 +188,16 @@ bool Krylov<real>::stop() {
 	return false;
 }
 
+template<typename real>
+typename Krylov<real>::Magnitude Krylov<real>::stepToRadius(size_t n, const real* x, const real* p, Magnitude radius) {
+	//solve |p|^2 tau^2 + 2 Re(x.p) tau + |x|^2 - radius^2 = 0 for the positive real root
+	Magnitude xx = ScalarTraits<real>::realPart(Vector<real>::dot(n, x, x));
+	Magnitude xp = ScalarTraits<real>::realPart(Vector<real>::dot(n, x, p));
+	Magnitude pp = ScalarTraits<real>::realPart(Vector<real>::dot(n, p, p));
+	if (pp == 0) return 0;
+	Magnitude discr = xp * xp - pp * (xx - radius * radius);
+	if (discr < 0) discr = 0;
+	return (-xp + sqrt(discr)) / pp;
+}
+
 }
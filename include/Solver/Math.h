@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+math functions for every real type the solvers are instantiated with
+
+templates call sqrt, fabs, isfinite, fmin and fmax unqualified, so that:
+- float / double / long double find the std overloads brought in here,
+- DoubleDouble finds its own overloads by ADL,
+- __float128, which has no namespace to look in, finds the overloads below.
+*/
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SIZEOF_FLOAT128__) && !defined(SOLVER_NO_FLOAT128)
+#define SOLVER_HAS_FLOAT128 1
+#endif
+
+namespace Solver {
+
+using std::sqrt;
+using std::fabs;
+using std::isfinite;
+using std::fmin;
+using std::fmax;
+
+#if defined(SOLVER_HAS_FLOAT128)
+
+//implemented without libquadmath, so nothing extra needs linking
+
+inline __float128 fabs(__float128 x) { return x < 0 ? -x : x; }
+
+inline bool isfinite(__float128 x) { return x - x == 0; }
+
+inline __float128 fmin(__float128 a, __float128 b) { return b < a ? b : a; }
+inline __float128 fmax(__float128 a, __float128 b) { return a < b ? b : a; }
+
+//two Newton steps from the double estimate: 53 -> 106 -> 113 bits
+inline __float128 sqrt(__float128 x) {
+	if (!(x > 0)) return x == 0 ? x : std::numeric_limits<double>::quiet_NaN();
+	if (!isfinite(x)) return x;
+	//scale into double's exponent range
+	int scale = 0;
+	while (x > (__float128)1e300) { x *= (__float128)1e-300; scale += 150; }
+	while (x < (__float128)1e-300) { x *= (__float128)1e300; scale -= 150; }
+	__float128 y = std::sqrt((double)x);
+	y = (y + x / y) * (__float128).5;
+	y = (y + x / y) * (__float128).5;
+	for (; scale > 0; scale -= 150) y *= (__float128)1e150;
+	for (; scale < 0; scale += 150) y *= (__float128)1e-150;
+	return y;
+}
+
+#endif
+
+}
+
+#if defined(SOLVER_HAS_FLOAT128)
+namespace std {
+
+//libstdc++ doesn't specialize numeric_limits for __float128 in strict mode
+template<>
+struct numeric_limits<__float128> {
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = false;
+	static constexpr bool has_infinity = true;
+	static constexpr bool has_quiet_NaN = true;
+	static constexpr int digits = 113;
+	static constexpr int digits10 = 33;
+	static constexpr int max_digits10 = 36;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = -16381;
+	static constexpr int max_exponent = 16384;
+	static constexpr __float128 min() noexcept { return pow2(-16382); }
+	static constexpr __float128 max() noexcept { return pow2(16383) * (2 - epsilon()); }
+	static constexpr __float128 lowest() noexcept { return -max(); }
+	static constexpr __float128 epsilon() noexcept { return pow2(-112); }
+	static constexpr __float128 infinity() noexcept { return __builtin_huge_valq(); }
+	static constexpr __float128 quiet_NaN() noexcept { return __builtin_nanq(""); }
+private:
+	//2^e by squaring, since strict mode has no literal suffix for __float128
+	static constexpr __float128 pow2(int e) {
+		__float128 base = e < 0 ? (__float128).5 : (__float128)2;
+		__float128 result = 1;
+		for (unsigned int k = e < 0 ? -e : e; k;) {
+			if (k & 1) result *= base;
+			k >>= 1;
+			if (k) base *= base;
+		}
+		return result;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Solver/Krylov.h"
+#include <vector>
+
+namespace Solver {
+
+/*
+solves (A + shifts[k] I) x_k = b for every k with one Krylov space
+Jegerlehner (1996). "Krylov space solvers for shifted linear systems." arXiv:hep-lat/9612014
+
+CG runs on the seed system k = 0.  the shifted residuals stay collinear with the seed's, r_k = zeta_k r,
+and the shifted step lengths follow from the seed's by a scalar recurrence,
+so all shifts cost one operator application per iteration, plus an x_k and p_k update per unconverged shift.
+
+A + shifts[k] I must be Hermitian positive definite for every k, which is why shifts are Magnitude, where MultiShiftGMRES's are real.
+make shifts[0] the smallest shift: its system converges slowest.
+the residual is the largest |r_k|.  shifts are no longer updated once they are within epsilon.
+
+x is [n * numShifts], x_k = x + n * k.  it is zeroed: the recurrences need every system to start from r = b.
+MInv and trustRadius are not supported: preconditioning breaks the shift invariance of the Krylov space.
+*/
+template<typename real>
+struct MultiShiftConjGrad : public Krylov<real> {
+	using Super = Krylov<real>;
+
+	using Func = typename Super::Func;
+	using Magnitude = typename Super::Magnitude;
+	using Traits = ScalarTraits<real>;
+
+	MultiShiftConjGrad(
+		size_t n,
+		size_t numShifts,
+		const Magnitude* shifts,
+		real* x,
+		const real* b,
+		Func A,
+		Magnitude epsilon = 1e-7,
+		int maxiter = -1,
+		std::shared_ptr<Allocator<real>> allocator = nullptr);
+
+	virtual void solve();
+
+	size_t getNumShifts() const { return shifts.size(); }
+
+	//|r_k| of shift k
+	Magnitude getShiftResidual(size_t k) const { return shiftResiduals[k]; }
+
+	//elements of WorkspaceAllocator space solve() needs
+	static size_t getWorkspaceSize(size_t n, size_t numShifts);
+
+protected:
+	std::vector<Magnitude> shifts;
+	std::vector<Magnitude> shiftResiduals;
+};
+
+}
+
+
+#include "Solver/Vector.h"
+#include "Solver/Expr.h"
+#include "Common/Exception.h"
+#include <string.h>	//memset
+
+namespace Solver {
+
+template<typename real>
+MultiShiftConjGrad<real>::MultiShiftConjGrad(size_t n, size_t numShifts, const Magnitude* shifts_, real* x, const real* b, Func A, Magnitude epsilon, int maxiter, std::shared_ptr<Allocator<real>> allocator)
+: Super(n, x, b, A, epsilon, maxiter, allocator)
+, shifts(shifts_, shifts_ + numShifts)
+, shiftResiduals(numShifts, Magnitude(0))
+{
+	if (!numShifts) throw Common::Exception() << "MultiShiftConjGrad needs at least one shift";
+}
+
+template<typename real>
+size_t MultiShiftConjGrad<real>::getWorkspaceSize(size_t n, size_t numShifts) {
+	return WorkspaceAllocator<real>::getAllocationSize(n) * 3	//r, p, Ap
+		+ WorkspaceAllocator<real>::getAllocationSize(n * (numShifts - 1));	//p_k
+}
+
+/*
+seed CG on A + shifts[0] I: x += alpha p, r -= alpha A p, p = r + beta p
+shift k, sigma = shifts[k] - shifts[0]:
+	zeta' = zeta zetaPrev alphaPrev / (alpha betaPrev (zetaPrev - zeta) + zetaPrev alphaPrev (1 + sigma alpha))
+	x_k += alpha zeta' / zeta p_k
+	p_k = zeta' r + beta (zeta' / zeta)^2 p_k
+*/
+template<typename real>
+void MultiShiftConjGrad<real>::solve() {
+	if (this->MInv) throw Common::Exception() << "MultiShiftConjGrad doesn't support MInv";
+	if (this->trustRadius > 0) throw Common::Exception() << "MultiShiftConjGrad doesn't support trustRadius";
+
+	size_t n = this->n;
+	size_t numShifts = shifts.size();
+	Buffer<real> r_(this->allocator, n, "MultiShiftConjGrad r");
+	real* r = r_.data();
+	Buffer<real> p_(this->allocator, n, "MultiShiftConjGrad p");
+	real* p = p_.data();
+	Buffer<real> Ap_(this->allocator, n, "MultiShiftConjGrad Ap");
+	real* Ap = Ap_.data();
+	Buffer<real> pk_(this->allocator, n * (numShifts - 1), "MultiShiftConjGrad p_k");
+	auto pk = [&](size_t k) { return pk_.data() + n * (k - 1); };	//p_k for shift k >= 1
+
+	size_t numThreads = this->numThreads;
+	auto xv = view(n, this->x);
+	auto bv = view(n, this->b);
+	auto rv = view(n, r);
+	auto pv = view(n, p);
+	auto Apv = view(n, Ap);
+
+	memset((void*)this->x, 0, sizeof(real) * n * numShifts);
+
+	//x_k = 0, r = p = p_k = b
+	auto rr = dot(rv, rv);
+	evalParallel(numThreads, rv = bv, pv = bv, rr);
+	for (size_t k = 1; k < numShifts; ++k) {
+		evalParallel(numThreads, view(n, pk(k)) = bv);
+	}
+	real rDotR = rr;
+	Magnitude rNormL2 = sqrt(Traits::realPart(rDotR));
+	Magnitude bNormL2 = rNormL2;
+
+	std::vector<real> zeta(numShifts, real(1));
+	std::vector<real> zetaPrev(numShifts, real(1));
+	std::vector<real> zetaNext(numShifts, real(1));
+	std::vector<bool> active(numShifts, true);
+	real alphaPrev = 1;
+	real beta = 0;
+
+	this->iter = 0;
+	std::fill(shiftResiduals.begin(), shiftResiduals.end(), rNormL2);
+	this->residual = this->calcResidual(rNormL2, bNormL2, r);
+	if (this->stop()) return;
+
+	for (this->iter = 1; this->iter <= this->maxiter; ++this->iter) {
+		//Ap = (A + shifts[0] I) p
+		this->A(Ap, p);
+		auto pAp_ = dot(pv, Apv);
+		evalParallel(numThreads, Apv += pv * real(shifts[0]), pAp_);
+		real alpha = rDotR / real(pAp_);
+
+		//shifted steps, from the seed's alpha and the previous beta
+		for (size_t k = 1; k < numShifts; ++k) {
+			if (!active[k]) continue;
+			real sigma = shifts[k] - shifts[0];
+			zetaNext[k] = zeta[k] * zetaPrev[k] * alphaPrev
+				/ (alpha * beta * (zetaPrev[k] - zeta[k]) + zetaPrev[k] * alphaPrev * (real(1) + sigma * alpha));
+			real alphaK = alpha * zetaNext[k] / zeta[k];
+			evalParallel(numThreads, view(n, this->x + n * k) += view(n, pk(k)) * alphaK);
+		}
+
+		//x += alpha p, r -= alpha Ap, and |r|^2 in one pass
+		auto nrr = dot(rv, rv);
+		evalParallel(numThreads, xv += pv * alpha, rv -= Apv * alpha, nrr);
+		real nRDotR = nrr;
+		beta = nRDotR / rDotR;
+		rDotR = nRDotR;
+		alphaPrev = alpha;
+		rNormL2 = sqrt(Traits::realPart(rDotR));
+
+		evalParallel(numThreads, pv = rv + pv * beta);
+		shiftResiduals[0] = rNormL2;
+		Magnitude maxResidual = rNormL2;
+		for (size_t k = 1; k < numShifts; ++k) {
+			if (!active[k]) {
+				maxResidual = fmax(maxResidual, shiftResiduals[k]);
+				continue;
+			}
+			real ratio = zetaNext[k] / zeta[k];
+			real betaK = beta * ratio * ratio;
+			evalParallel(numThreads, view(n, pk(k)) = rv * zetaNext[k] + view(n, pk(k)) * betaK);
+			zetaPrev[k] = zeta[k];
+			zeta[k] = zetaNext[k];
+
+			shiftResiduals[k] = Traits::abs(zeta[k]) * rNormL2;
+			maxResidual = fmax(maxResidual, shiftResiduals[k]);
+			if (shiftResiduals[k] < this->epsilon) active[k] = false;
+		}
+
+		this->residual = this->calcResidual(maxResidual, bNormL2, r);
+		if (this->stop()) break;
+	}
+}
+
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "Solver/GMRES.h"
+#include <vector>
+
+namespace Solver {
+
+/*
+solves (A + shifts[k] I) x_k = b for every k with one restarted Arnoldi process
+Frommer, Glässner (1998). "Restarted GMRES for Shifted Linear Systems." SIAM Journal on Scientific Computing vol. 19 no. 1
+
+the Krylov space of A + sigma I doesn't depend on sigma, and neither does the Arnoldi basis: only h shifts by sigma on its diagonal.
+GMRES runs on the seed system k = 0, and at the end of each cycle every other system takes the step in the same basis
+that keeps its residual collinear with the seed's, r_k = rho_k r, which costs a (m+1) x (m+1) dense solve and an n * m update per shift.
+so all shifts cost one operator application per iteration, the same as a single solve.
+
+shifts have the element type, so they are complex for the std::complex instantiations:
+GMRES only relies on the shift invariance of the Krylov space, not on A + sigma I being definite,
+so complex shifts of a real problem are solved by instantiating with std::complex.
+MultiShiftConjGrad takes Magnitude shifts instead, since CG needs every A + sigma I Hermitian positive definite.
+
+make shifts[0] the system that converges slowest, i.e. the smallest shift when A is positive real.
+the stopping residual is |r| max(1, |rho_k|).  within a cycle the rho_k are those of the previous restart,
+so getShiftResidual() is only exact as of the last restart.
+
+x is [n * numShifts], x_k = x + n * k.  it is zeroed: the shifted systems need collinear initial residuals, which b is.
+MInv and trustRadius are not supported: preconditioning breaks the shift invariance of the Krylov space.
+*/
+template<typename real>
+struct MultiShiftGMRES : public GMRES<real> {
+	using Super = GMRES<real>;
+
+	using Func = typename Super::Func;
+	using Magnitude = typename Super::Magnitude;
+	using Traits = ScalarTraits<real>;
+
+	MultiShiftGMRES(
+		size_t n,
+		size_t numShifts,
+		const real* shifts,
+		real* x,
+		const real* b,
+		Func A,
+		Magnitude epsilon = 1e-7,
+		int maxiter = -1,
+		int restart = -1,
+		std::shared_ptr<Allocator<real>> allocator = nullptr);
+	virtual ~MultiShiftGMRES();
+
+	virtual void solve();
+
+	size_t getNumShifts() const { return shifts.size(); }
+
+	//|r_k| of shift k
+	Magnitude getShiftResidual(size_t k) const { return shiftResiduals[k]; }
+
+	//elements of WorkspaceAllocator space solve() needs.  restart = -1 means n, same as the constructor.
+	static size_t getWorkspaceSize(size_t n, int restart = -1);
+
+	virtual size_t getMemoryFootprint() const;
+
+protected:
+	std::vector<real> shifts;
+	std::vector<real> rho;						//r_k = rho_k r
+	std::vector<Magnitude> shiftResiduals;
+	std::vector<bool> converged;				//shifts within epsilon stop being updated
+
+	real* hArnoldi;	//[m+1,m] h before the Givens rotations
+
+	virtual void allocateBuffers();
+	virtual void freeBuffers();
+
+	virtual Magnitude calcResidual(Magnitude rNormL2, Magnitude bNormL2, const real* r);
+
+	virtual void applyOperator(real* y, const real* x);
+	virtual Magnitude arnoldiStep(Index i);
+	virtual void cycleEnd(Index i, Magnitude beta);
+};
+
+}
+
+
+#include "Solver/DenseInverse.h"
+#include "Solver/Vector.h"
+#include "Solver/Math.h"
+#include "Common/Exception.h"
+#include <memory.h>
+
+namespace Solver {
+
+template<typename real>
+MultiShiftGMRES<real>::MultiShiftGMRES(size_t n, size_t numShifts, const real* shifts_, real* x, const real* b, Func A, Magnitude epsilon, int maxiter, int restart, std::shared_ptr<Allocator<real>> allocator)
+: Super(n, x, b, A, epsilon, maxiter, restart, allocator)
+, shifts(shifts_, shifts_ + numShifts)
+, rho(numShifts, real(1))
+, shiftResiduals(numShifts, Magnitude(0))
+, converged(numShifts, false)
+, hArnoldi(nullptr)
+{
+	if (!numShifts) throw Common::Exception() << "MultiShiftGMRES needs at least one shift";
+}
+
+template<typename real>
+MultiShiftGMRES<real>::~MultiShiftGMRES() {
+	freeBuffers();
+}
+
+template<typename real>
+size_t MultiShiftGMRES<real>::getWorkspaceSize(size_t n, int restart) {
+	size_t m = restart == -1 ? n : restart;
+	return Super::getWorkspaceSize(n, restart)
+		+ WorkspaceAllocator<real>::getAllocationSize((m + 1) * m);	//hArnoldi
+}
+
+template<typename real>
+void MultiShiftGMRES<real>::allocateBuffers() {
+	Super::allocateBuffers();
+	hArnoldi = this->buffersAllocator->allocate((this->restart + 1) * this->restart, "MultiShiftGMRES h");
+}
+
+template<typename real>
+size_t MultiShiftGMRES<real>::getMemoryFootprint() const {
+	if (!this->buffersAllocator) return 0;
+	return Super::getMemoryFootprint() + sizeof(real) * (this->restart + 1) * this->restart;	//hArnoldi
+}
+
+template<typename real>
+void MultiShiftGMRES<real>::freeBuffers() {
+	if (this->buffersAllocator && hArnoldi) {
+		this->buffersAllocator->deallocate(hArnoldi, (this->restart + 1) * this->restart);
+	}
+	hArnoldi = nullptr;
+	Super::freeBuffers();
+}
+
+template<typename real>
+void MultiShiftGMRES<real>::solve() {
+	if (this->MInv) throw Common::Exception() << "MultiShiftGMRES doesn't support MInv";
+	if (this->trustRadius > 0) throw Common::Exception() << "MultiShiftGMRES doesn't support trustRadius";
+
+	memset((void*)this->x, 0, sizeof(real) * this->n * shifts.size());
+	std::fill(rho.begin(), rho.end(), real(1));
+	std::fill(converged.begin(), converged.end(), false);
+	Super::solve();
+}
+
+template<typename real>
+typename MultiShiftGMRES<real>::Magnitude MultiShiftGMRES<real>::calcResidual(Magnitude rNormL2, Magnitude, const real*) {
+	Magnitude maxResidual = rNormL2;
+	shiftResiduals[0] = rNormL2;
+	for (size_t k = 1; k < shifts.size(); ++k) {
+		if (!converged[k]) shiftResiduals[k] = Traits::abs(rho[k]) * rNormL2;
+		maxResidual = fmax(maxResidual, shiftResiduals[k]);
+	}
+	return maxResidual;
+}
+
+//y = (A + shifts[0] I) x
+template<typename real>
+void MultiShiftGMRES<real>::applyOperator(real* y, const real* x) {
+	this->A(y, x);
+	for (Index i = 0; i < (Index)this->n; ++i) {
+		y[i] += shifts[0] * x[i];
+	}
+}
+
+template<typename real>
+typename MultiShiftGMRES<real>::Magnitude MultiShiftGMRES<real>::arnoldiStep(Index i) {
+	Magnitude wNormL2 = Super::arnoldiStep(i);
+	//keep the column before it is rotated, for the shifted systems
+	Index m = this->restart;
+	for (Index k = 0; k <= i+1; ++k) {
+		hArnoldi[k + (m+1) * i] = this->h[k + (m+1) * i];
+	}
+	return wNormL2;
+}
+
+/*
+at the end of a cycle the seed residual is r = V z, z = beta e1 - H y in the unrotated Arnoldi coordinates.
+each shifted system starts the cycle at rho_k beta v[0], so its new residual is V (rho_k beta e1 - (H + sigma_k I) y_k),
+and solving
+	(H + sigma_k I) y_k + rho_k' z = rho_k beta e1
+for y_k and rho_k' makes it collinear with the seed's again, r_k' = rho_k' r.
+after a breakdown z = 0 and the last row of H is zero, so the upper i x i block is solved instead, with rho_k' = 0.
+*/
+template<typename real>
+void MultiShiftGMRES<real>::cycleEnd(Index i, Magnitude beta) {
+	if (!i) return;
+	size_t n = this->n;
+	Index m = this->restart;
+
+	std::vector<real> z(i+1);
+	this->arnoldiResidual(i, z.data());
+
+	Index size = this->breakdown ? i : i+1;
+	std::vector<real> a(size * size);
+	std::vector<real> rhs(size);
+	std::vector<real> sol(size);
+	for (size_t k = 1; k < shifts.size(); ++k) {
+		if (converged[k]) continue;
+		real sigma = shifts[k] - shifts[0];
+		//a = [H + sigma I, z]
+		for (Index j = 0; j < i; ++j) {
+			for (Index row = 0; row < size; ++row) {
+				a[row + size * j] = row <= j+1 ? hArnoldi[row + (m+1) * j] : real(0);
+			}
+			a[j + size * j] += sigma;
+		}
+		if (!this->breakdown) {
+			for (Index row = 0; row <= i; ++row) {
+				a[row + size * i] = z[row];
+			}
+		}
+		std::fill(rhs.begin(), rhs.end(), real(0));
+		rhs[0] = rho[k] * beta;
+		HouseholderQR<real>().solveLinear(size, sol.data(), a.data(), rhs.data());
+
+		//x_k += v(:, 1:i) y_k
+		real* xk = this->x + n * k;
+		for (Index j = 0; j < i; ++j) {
+			for (Index l = 0; l < (Index)n; ++l) {
+				xk[l] += this->v[l + n * j] * sol[j];
+			}
+		}
+		rho[k] = this->breakdown ? real(0) : sol[i];
+
+		shiftResiduals[k] = Traits::abs(rho[k]) * Vector<real>::normL2(i+1, z.data());
+		if (shiftResiduals[k] < this->epsilon) converged[k] = true;
+	}
+}
+
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "Solver/CSR.h"
+#include "Solver/Krylov.h"
+#include "Solver/Preconditioner.h"
+#include <vector>
+
+namespace Solver {
+
+/*
+multicolor Gauss-Seidel / SOR
+rows of the same color don't reference each other, so each color's sweep updates its rows independently, split across threads
+for a 5- or 7-point stencil this is red-black ordering, for a 9- or 27-point stencil it is 4 or 8 colors
+
+smooth() is the multigrid smoother interface, operator() is the preconditioner interface
+
+A is referenced, not copied, and must outlive this object.
+a Preconditioner: usable as Krylov::MInv via getMInv(), which references this object, or as JFNK's preconditioner.
+*/
+template<typename real>
+struct MulticolorGaussSeidel : public Preconditioner<real> {
+	using Func = typename Krylov<real>::Func;
+
+	//colors A's graph with colorGreedy
+	MulticolorGaussSeidel(const CSR<real>& A, size_t numThreads = 0);
+
+	//colors[i] = color of row i.  rows of the same color must not be coupled in A.
+	MulticolorGaussSeidel(const CSR<real>& A, const std::vector<int>& colors, size_t numThreads = 0);
+
+	/*
+	greedy coloring of the graph of A + A^T, in row order
+	for stencils in lexicographic order this reproduces the red-black and 2^dim colorings
+	*/
+	static std::vector<int> colorGreedy(const CSR<real>& A);
+
+	/*
+	colors a structured grid, size[0] being the fastest index
+	diagonal = false: for stencils with only axis neighbors (5-point, 7-point): red-black by parity of the coordinate sum
+	diagonal = true: for stencils including diagonal neighbors (9-point, 27-point): 2^dim colors by per-axis parity
+	*/
+	static std::vector<int> colorGrid(const std::vector<size_t>& size, bool diagonal);
+
+	//performs sweeps of SOR on A x = b, in-place on x
+	void smooth(real* x, const real* b, int sweeps) const;
+
+	//y = sweeps of SOR on A y = x, starting from y = 0.  y and x can be the same memory
+	void operator()(real* y, const real* x);
+
+	//same as operator()
+	virtual void apply(real* y, const real* r) { (*this)(y, r); }
+
+	size_t getNumColors() const { return rowsOfColor.size(); }
+
+	//relaxation weight.  1 = Gauss-Seidel
+	real omega;
+
+	//number of sweeps per preconditioner application
+	int sweeps;
+
+	//follow each sweep with one in reverse color order, making the preconditioner symmetric (SSOR)
+	bool symmetric;
+
+	size_t numThreads;
+
+protected:
+	const CSR<real>& A;
+	std::vector<std::vector<Index>> rowsOfColor;
+	std::vector<real> tmp;
+
+	void init(const std::vector<int>& colors);
+	void sweepColor(real* x, const real* b, int color) const;
+};
+
+}
+
+
+#include "Solver/Parallel.h"
+#include <string.h>	//memcpy
+#include <algorithm>
+
+namespace Solver {
+
+template<typename real>
+MulticolorGaussSeidel<real>::MulticolorGaussSeidel(const CSR<real>& A_, size_t numThreads_)
+: omega(1)
+, sweeps(1)
+, symmetric(false)
+, numThreads(numThreads_)
+, A(A_)
+, tmp(A_.rows)
+{
+	init(colorGreedy(A));
+}
+
+template<typename real>
+MulticolorGaussSeidel<real>::MulticolorGaussSeidel(const CSR<real>& A_, const std::vector<int>& colors, size_t numThreads_)
+: omega(1)
+, sweeps(1)
+, symmetric(false)
+, numThreads(numThreads_)
+, A(A_)
+, tmp(A_.rows)
+{
+	init(colors);
+}
+
+template<typename real>
+void MulticolorGaussSeidel<real>::init(const std::vector<int>& colors) {
+	int numColors = 0;
+	for (int color : colors) {
+		numColors = std::max(numColors, color + 1);
+	}
+	rowsOfColor.resize(numColors);
+	for (Index i = 0; i < (Index)colors.size(); ++i) {
+		rowsOfColor[colors[i]].push_back(i);
+	}
+}
+
+template<typename real>
+std::vector<int> MulticolorGaussSeidel<real>::colorGreedy(const CSR<real>& A) {
+	CSR<real> AT = A.transpose();
+	const CSR<real>* patterns[] = {&A, &AT};
+	std::vector<int> colors(A.rows, -1);
+	std::vector<Index> usedBy;	//usedBy[color] = the last row that saw a neighbor of that color
+	for (Index i = 0; i < (Index)A.rows; ++i) {
+		for (const CSR<real>* M : patterns) {
+			for (Index k = M->rowOffsets[i]; k < M->rowOffsets[i+1]; ++k) {
+				Index j = M->colIndexes[k];
+				if (j != i && colors[j] != -1) {
+					if ((int)usedBy.size() <= colors[j]) usedBy.resize(colors[j] + 1, -1);
+					usedBy[colors[j]] = i;
+				}
+			}
+		}
+		int color = 0;
+		while (color < (int)usedBy.size() && usedBy[color] == i) ++color;
+		colors[i] = color;
+	}
+	return colors;
+}
+
+template<typename real>
+std::vector<int> MulticolorGaussSeidel<real>::colorGrid(const std::vector<size_t>& size, bool diagonal) {
+	size_t n = 1;
+	for (size_t s : size) n *= s;
+	std::vector<int> colors(n);
+	for (size_t index = 0; index < n; ++index) {
+		size_t rest = index;
+		int color = 0;
+		for (Index d = 0; d < (Index)size.size(); ++d) {
+			int parity = (int)(rest % size[d]) & 1;
+			rest /= size[d];
+			color += diagonal ? parity << d : parity;
+		}
+		colors[index] = diagonal ? color : color & 1;
+	}
+	return colors;
+}
+
+template<typename real>
+void MulticolorGaussSeidel<real>::sweepColor(real* x, const real* b, int color) const {
+	const std::vector<Index>& rows = rowsOfColor[color];
+	Parallel::forRange(rows.size(), numThreads, [&](size_t begin, size_t end) {
+		for (size_t r = begin; r < end; ++r) {
+			Index i = rows[r];
+			real sum = b[i];
+			real diag = 0;
+			for (Index k = A.rowOffsets[i]; k < A.rowOffsets[i+1]; ++k) {
+				Index j = A.colIndexes[k];
+				if (j == i) {
+					diag = A.values[k];
+				} else {
+					sum -= A.values[k] * x[j];
+				}
+			}
+			if (diag != 0) {
+				x[i] += omega * (sum / diag - x[i]);
+			}
+		}
+	});
+}
+
+template<typename real>
+void MulticolorGaussSeidel<real>::smooth(real* x, const real* b, int sweeps) const {
+	int numColors = (int)rowsOfColor.size();
+	for (int sweep = 0; sweep < sweeps; ++sweep) {
+		for (int color = 0; color < numColors; ++color) {
+			sweepColor(x, b, color);
+		}
+		if (symmetric) {
+			for (int color = numColors - 1; color >= 0; --color) {
+				sweepColor(x, b, color);
+			}
+		}
+	}
+}
+
+template<typename real>
+void MulticolorGaussSeidel<real>::operator()(real* y, const real* x) {
+	memcpy(tmp.data(), x, sizeof(real) * A.rows);
+	memset(y, 0, sizeof(real) * A.rows);
+	smooth(y, tmp.data(), sweeps);
+}
+
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdlib.h>	//size_t
+#if defined(__linux__)
+#include <pthread.h>	//pthread_setaffinity_np
+#include <sched.h>	//cpu_set_t
+#endif
+
+namespace Solver {
+
+/*
+static partitioning of work across a pool of persistent threads
+every threaded kernel splits [0,n) with getRange and runs range t on worker t,
+so data first touched by range t of one call is used by the same thread in every other call with the same numThreads.
+workers are pinned, worker t to the t'th cpu the process may run on (linux only), so that thread also stays on the same NUMA node.
+*/
+struct Parallel {
+	//default number of threads: the hardware concurrency, or 1 if unknown
+	static size_t getDefaultNumThreads() {
+		size_t numThreads = std::thread::hardware_concurrency();
+		return numThreads ? numThreads : 1;
+	}
+
+	/*
+	whether workers are pinned to cpus.  default true.
+	only read when a worker is started, so set it before the first threaded call.
+	turn it off when several processes share the machine and pin their own threads, i.e. under MPI.
+	*/
+	static inline bool pinWorkers = true;
+
+	//the contiguous range [begin, end) of [0, n) handled by thread t of numThreads
+	static void getRange(size_t n, size_t t, size_t numThreads, size_t& begin, size_t& end) {
+		size_t chunk = n / numThreads;
+		size_t extra = n % numThreads;
+		begin = chunk * t + std::min(t, extra);
+		end = begin + chunk + (t < extra ? 1 : 0);
+	}
+
+	/*
+	calls f(begin, end) once per thread over the ranges of [0, n)
+	range t < numThreads-1 runs on pool worker t, the last range on the calling thread
+	calls from inside a range run serially
+	if f throws then every range still finishes before the first exception thrown is rethrown
+	numThreads = 0 uses the default
+	*/
+	template<typename F>
+	static void forRange(size_t n, size_t numThreads, F f) {
+		if (!numThreads) numThreads = getDefaultNumThreads();
+		numThreads = std::min(numThreads, n);
+		if (numThreads <= 1 || Pool::insideRun()) {
+			if (n) f((size_t)0, n);
+			return;
+		}
+		Pool::get().run(numThreads - 1, [&f, n, numThreads](size_t t) {
+			size_t begin, end;
+			getRange(n, t, numThreads, begin, end);
+			f(begin, end);
+		}, [&f, n, numThreads]() {
+			size_t begin, end;
+			getRange(n, numThreads - 1, numThreads, begin, end);
+			f(begin, end);
+		});
+	}
+
+	//calls f(i) for each i in [0, n), split into ranges across threads
+	template<typename F>
+	static void forEach(size_t n, size_t numThreads, F f) {
+		forRange(n, numThreads, [&f](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				f(i);
+			}
+		});
+	}
+
+protected:
+	/*
+	workers are started on first use and grown as needed, and wait on a condition variable between runs
+	one run at a time: concurrent callers queue on runMutex
+	*/
+	struct Pool {
+		static Pool& get() {
+			static Pool pool;
+			return pool;
+		}
+
+		static bool& insideRun() {
+			thread_local bool inside = false;
+			return inside;
+		}
+
+		/*
+		job(t) on workers t < numWorkers, and last() on the calling thread, returning once all are done
+		an exception from any of them is held until all are done, since the workers reference job_, and then the first one is rethrown
+		*/
+		void run(size_t numWorkers, const std::function<void(size_t)>& job_, const std::function<void()>& last) {
+			std::lock_guard<std::mutex> runLock(runMutex);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				while (workers.size() < numWorkers) {
+					size_t t = workers.size();
+					workers.emplace_back([this, t]() { workerLoop(t); });
+				}
+				job = &job_;
+				error = nullptr;
+				activeWorkers = numWorkers;
+				pending = numWorkers;
+				++generation;
+			}
+			wake.notify_all();
+
+			insideRun() = true;
+			std::exception_ptr lastError;
+			try {
+				last();
+			} catch (...) {
+				lastError = std::current_exception();
+			}
+			insideRun() = false;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			if (lastError && !error) error = lastError;
+			done.wait(lock, [this]() { return pending == 0; });
+			job = nullptr;
+			std::exception_ptr firstError = error;
+			error = nullptr;
+			lock.unlock();
+			if (firstError) std::rethrow_exception(firstError);
+		}
+
+		~Pool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto& worker : workers) {
+				worker.join();
+			}
+		}
+
+	protected:
+		void workerLoop(size_t t) {
+			if (pinWorkers) pin(t);
+			insideRun() = true;
+			size_t seen = 0;
+			for (;;) {
+				const std::function<void(size_t)>* myJob = nullptr;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&]() { return stopping || (generation != seen && t < activeWorkers); });
+					if (stopping) return;
+					seen = generation;
+					myJob = job;
+				}
+				//an exception escaping the thread would terminate, so it is handed to run()
+				std::exception_ptr myError;
+				try {
+					(*myJob)(t);
+				} catch (...) {
+					myError = std::current_exception();
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (myError && !error) error = myError;
+					if (--pending == 0) done.notify_one();
+				}
+			}
+		}
+
+		//pin to the t'th cpu of the process affinity mask, wrapping around
+		static void pin(size_t t) {
+#if defined(__linux__)
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if (sched_getaffinity(0, sizeof(allowed), &allowed)) return;
+			int count = CPU_COUNT(&allowed);
+			if (!count) return;
+			int k = (int)(t % (size_t)count);
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+				if (!CPU_ISSET(cpu, &allowed)) continue;
+				if (k--) continue;
+				cpu_set_t one;
+				CPU_ZERO(&one);
+				CPU_SET(cpu, &one);
+				pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+				return;
+			}
+#else
+			(void)t;
+#endif
+		}
+
+		std::mutex runMutex;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		std::vector<std::thread> workers;
+		const std::function<void(size_t)>* job = nullptr;
+		std::exception_ptr error;	//first exception of the current run
+		size_t activeWorkers = 0;
+		size_t pending = 0;
+		size_t generation = 0;
+		bool stopping = false;
+	};
+};
+
+}
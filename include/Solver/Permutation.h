@@ -0,0 +1,357 @@
+#pragma once
+
+#include "Solver/CSR.h"
+#include "Solver/Krylov.h"
+#include <memory>
+#include <vector>
+
+namespace Solver {
+
+/*
+symmetric reordering of unknowns
+perm[newIndex] = oldIndex
+
+reverseCuthillMcKee reduces the bandwidth of A, for cache locality in SpMV and less fill in factorizations
+nestedDissection orders recursive graph bisections with their separators last, for less fill in factorizations
+
+the graph used is that of A + A^T
+*/
+template<typename real>
+struct Permutation {
+	using Func = typename Krylov<real>::Func;
+
+	//creates the solver in the permuted ordering, given the permuted matrix
+	using CreateSolver = std::function<std::shared_ptr<Krylov<real>>(size_t n, real* x, real* b, const CSR<real>& A)>;
+
+	Permutation(const std::vector<Index>& perm);
+
+	/*
+	George, Liu "Computer Solution of Large Sparse Positive Definite Systems" 1981
+	starting from a pseudo-peripheral node of each connected component
+	*/
+	static Permutation reverseCuthillMcKee(const CSR<real>& A);
+
+	/*
+	George (1973). "Nested Dissection of a Regular Finite Element Mesh." SIAM Journal on Numerical Analysis vol. 10 no. 2
+	separators are the middle level of a level structure from a pseudo-peripheral node
+	parts of size <= minSize are left in their original order
+	*/
+	static Permutation nestedDissection(const CSR<real>& A, size_t minSize = 64);
+
+	size_t size() const { return perm.size(); }
+
+	//y[new] = x[perm[new]].  y and x cannot be the same memory
+	void apply(real* y, const real* x) const;
+
+	//y[perm[new]] = x[new].  y and x cannot be the same memory
+	void undo(real* y, const real* x) const;
+
+	//returns P A P^T, with sorted rows
+	CSR<real> apply(const CSR<real>& A) const;
+
+	//returns the matrix-free P A P^T
+	Func apply(Func A) const;
+
+	/*
+	solves A x = b in the permuted ordering
+	permutes A, x and b, creates and runs the solver on them, then un-permutes the solution back into x
+	*/
+	void solve(const CSR<real>& A, real* x, const real* b, CreateSolver createSolver) const;
+
+	std::vector<Index> perm;
+	std::vector<Index> inverse;	//inverse[oldIndex] = newIndex
+
+protected:
+	//adjacency of A + A^T without the diagonal
+	struct Graph {
+		std::vector<Index> offsets;
+		std::vector<Index> adj;
+		Graph(const CSR<real>& A);
+		Index degree(Index i) const { return offsets[i+1] - offsets[i]; }
+
+		//visited marks for levels(), compared against an incrementing stamp so they never need clearing
+		mutable std::vector<Index> mark;
+		mutable Index stamp;
+
+		/*
+		breadth-first level structure from root over the nodes with label[node] == labelValue
+		order = nodes in visit order, levelStart = where each level begins in order, plus the end
+		*/
+		void levels(Index root, const std::vector<Index>& label, Index labelValue, std::vector<Index>& order, std::vector<Index>& levelStart) const;
+
+		//finds a node of near-maximal eccentricity by repeated level structures
+		Index pseudoPeripheral(Index start, const std::vector<Index>& label, Index labelValue) const;
+	};
+};
+
+}
+
+
+#include <algorithm>
+#include <string.h>	//memcpy
+
+namespace Solver {
+
+template<typename real>
+Permutation<real>::Permutation(const std::vector<Index>& perm_)
+: perm(perm_)
+, inverse(perm_.size())
+{
+	for (Index i = 0; i < (Index)perm.size(); ++i) {
+		inverse[perm[i]] = i;
+	}
+}
+
+template<typename real>
+Permutation<real>::Graph::Graph(const CSR<real>& A)
+: offsets(A.rows + 1)
+, mark(A.rows, -1)
+, stamp(0)
+{
+	CSR<real> AT = A.transpose();
+	const CSR<real>* patterns[] = {&A, &AT};
+	for (Index i = 0; i < (Index)A.rows; ++i) {
+		mark[i] = i;	//skip the diagonal
+		for (const CSR<real>* M : patterns) {
+			for (Index k = M->rowOffsets[i]; k < M->rowOffsets[i+1]; ++k) {
+				Index j = M->colIndexes[k];
+				if (mark[j] != i) {
+					mark[j] = i;
+					adj.push_back(j);
+				}
+			}
+		}
+		offsets[i+1] = (Index)adj.size();
+	}
+	std::fill(mark.begin(), mark.end(), -1);
+	stamp = 0;
+}
+
+template<typename real>
+void Permutation<real>::Graph::levels(Index root, const std::vector<Index>& label, Index labelValue, std::vector<Index>& order, std::vector<Index>& levelStart) const {
+	++stamp;
+	order.clear();
+	levelStart.clear();
+	order.push_back(root);
+	mark[root] = stamp;
+	size_t begin = 0;
+	while (begin < order.size()) {
+		levelStart.push_back((Index)begin);
+		size_t end = order.size();
+		for (size_t k = begin; k < end; ++k) {
+			Index i = order[k];
+			for (Index e = offsets[i]; e < offsets[i+1]; ++e) {
+				Index j = adj[e];
+				if (mark[j] != stamp && label[j] == labelValue) {
+					mark[j] = stamp;
+					order.push_back(j);
+				}
+			}
+		}
+		begin = end;
+	}
+	levelStart.push_back((Index)order.size());
+}
+
+template<typename real>
+Index Permutation<real>::Graph::pseudoPeripheral(Index start, const std::vector<Index>& label, Index labelValue) const {
+	std::vector<Index> order, levelStart;
+	Index root = start;
+	levels(root, label, labelValue, order, levelStart);
+	Index eccentricity = (Index)levelStart.size();
+	for (;;) {
+		//min degree node of the last level
+		Index best = -1;
+		for (Index k = levelStart[levelStart.size()-2]; k < levelStart.back(); ++k) {
+			if (best == -1 || degree(order[k]) < degree(best)) best = order[k];
+		}
+		levels(best, label, labelValue, order, levelStart);
+		if ((Index)levelStart.size() <= eccentricity) break;
+		eccentricity = (Index)levelStart.size();
+		root = best;
+	}
+	return root;
+}
+
+template<typename real>
+Permutation<real> Permutation<real>::reverseCuthillMcKee(const CSR<real>& A) {
+	Graph graph(A);
+	size_t n = A.rows;
+	std::vector<Index> label(n, 0);	//0 = unordered, 1 = ordered
+	std::vector<Index> perm;
+	perm.reserve(n);
+	std::vector<Index> neighbors;
+	for (Index start = 0; start < (Index)n; ++start) {
+		if (label[start]) continue;
+		Index root = graph.pseudoPeripheral(start, label, 0);
+		size_t head = perm.size();
+		perm.push_back(root);
+		label[root] = 1;
+		while (head < perm.size()) {
+			Index i = perm[head++];
+			neighbors.clear();
+			for (Index e = graph.offsets[i]; e < graph.offsets[i+1]; ++e) {
+				Index j = graph.adj[e];
+				if (!label[j]) {
+					label[j] = 1;
+					neighbors.push_back(j);
+				}
+			}
+			std::stable_sort(neighbors.begin(), neighbors.end(), [&](Index a, Index b) {
+				return graph.degree(a) < graph.degree(b);
+			});
+			perm.insert(perm.end(), neighbors.begin(), neighbors.end());
+		}
+	}
+	std::reverse(perm.begin(), perm.end());
+	return Permutation(perm);
+}
+
+template<typename real>
+Permutation<real> Permutation<real>::nestedDissection(const CSR<real>& A, size_t minSize) {
+	Graph graph(A);
+	size_t n = A.rows;
+	//label = which part each node currently belongs to.  -1 = already ordered
+	std::vector<Index> label(n, 0);
+	std::vector<Index> perm(n);
+	Index nextLabel = 1;
+
+	//parts to dissect: nodes and where in perm their ordering starts
+	struct Part {
+		std::vector<Index> nodes;
+		Index permStart;
+	};
+	std::vector<Part> stack;
+	{
+		Part all;
+		for (Index i = 0; i < (Index)n; ++i) all.nodes.push_back(i);
+		all.permStart = 0;
+		stack.push_back(all);
+	}
+
+	std::vector<Index> order, levelStart;
+	while (!stack.empty()) {
+		Part part = std::move(stack.back());
+		stack.pop_back();
+		Index partLabel = nextLabel++;
+		for (Index i : part.nodes) label[i] = partLabel;
+
+		if (part.nodes.size() <= minSize) {
+			std::sort(part.nodes.begin(), part.nodes.end());
+			for (Index k = 0; k < (Index)part.nodes.size(); ++k) {
+				perm[part.permStart + k] = part.nodes[k];
+				label[part.nodes[k]] = -1;
+			}
+			continue;
+		}
+
+		//the level structure from a pseudo-peripheral node only covers its connected component
+		Index root = graph.pseudoPeripheral(part.nodes[0], label, partLabel);
+		graph.levels(root, label, partLabel, order, levelStart);
+
+		Part first, second, rest;
+		Index numLevels = (Index)levelStart.size() - 1;
+		if (order.size() < part.nodes.size()) {
+			//disconnected: split off this component and dissect both separately
+			first.nodes = order;
+			for (Index i : order) label[i] = 0;
+			for (Index i : part.nodes) {
+				if (label[i] == partLabel) rest.nodes.push_back(i);
+			}
+			first.permStart = part.permStart;
+			rest.permStart = part.permStart + (Index)first.nodes.size();
+			stack.push_back(std::move(first));
+			stack.push_back(std::move(rest));
+			continue;
+		}
+		if (numLevels < 3) {
+			//too few levels to separate
+			std::sort(part.nodes.begin(), part.nodes.end());
+			for (Index k = 0; k < (Index)part.nodes.size(); ++k) {
+				perm[part.permStart + k] = part.nodes[k];
+				label[part.nodes[k]] = -1;
+			}
+			continue;
+		}
+
+		//separate on the middle level, ordered last
+		Index mid = numLevels / 2;
+		for (Index k = 0; k < levelStart[mid]; ++k) first.nodes.push_back(order[k]);
+		for (Index k = levelStart[mid+1]; k < levelStart[numLevels]; ++k) second.nodes.push_back(order[k]);
+		Index separatorStart = part.permStart + (Index)(first.nodes.size() + second.nodes.size());
+		for (Index k = levelStart[mid]; k < levelStart[mid+1]; ++k) {
+			perm[separatorStart + k - levelStart[mid]] = order[k];
+			label[order[k]] = -1;
+		}
+		first.permStart = part.permStart;
+		second.permStart = part.permStart + (Index)first.nodes.size();
+		stack.push_back(std::move(first));
+		stack.push_back(std::move(second));
+	}
+	return Permutation(perm);
+}
+
+template<typename real>
+void Permutation<real>::apply(real* y, const real* x) const {
+	for (Index i = 0; i < (Index)perm.size(); ++i) {
+		y[i] = x[perm[i]];
+	}
+}
+
+template<typename real>
+void Permutation<real>::undo(real* y, const real* x) const {
+	for (Index i = 0; i < (Index)perm.size(); ++i) {
+		y[perm[i]] = x[i];
+	}
+}
+
+template<typename real>
+CSR<real> Permutation<real>::apply(const CSR<real>& A) const {
+	size_t n = perm.size();
+	CSR<real> PA(n, n);
+	PA.colIndexes.resize(A.getNNZ());
+	PA.values.resize(A.getNNZ());
+	std::vector<std::pair<Index, real>> row;
+	for (Index i = 0; i < (Index)n; ++i) {
+		Index oldRow = perm[i];
+		row.clear();
+		for (Index k = A.rowOffsets[oldRow]; k < A.rowOffsets[oldRow+1]; ++k) {
+			row.push_back(std::make_pair(inverse[A.colIndexes[k]], A.values[k]));
+		}
+		std::sort(row.begin(), row.end(), [](const std::pair<Index, real>& a, const std::pair<Index, real>& b) {
+			return a.first < b.first;
+		});
+		Index offset = PA.rowOffsets[i];
+		for (Index k = 0; k < (Index)row.size(); ++k) {
+			PA.colIndexes[offset + k] = row[k].first;
+			PA.values[offset + k] = row[k].second;
+		}
+		PA.rowOffsets[i+1] = offset + (Index)row.size();
+	}
+	return PA;
+}
+
+template<typename real>
+typename Permutation<real>::Func Permutation<real>::apply(Func A) const {
+	auto xOld = std::make_shared<std::vector<real>>(perm.size());
+	auto yOld = std::make_shared<std::vector<real>>(perm.size());
+	Permutation p = *this;
+	return [p, A, xOld, yOld](real* y, const real* x) {
+		p.undo(xOld->data(), x);
+		A(yOld->data(), xOld->data());
+		p.apply(y, yOld->data());
+	};
+}
+
+template<typename real>
+void Permutation<real>::solve(const CSR<real>& A, real* x, const real* b, CreateSolver createSolver) const {
+	size_t n = perm.size();
+	CSR<real> PA = apply(A);
+	std::vector<real> px(n), pb(n);
+	apply(px.data(), x);
+	apply(pb.data(), b);
+	createSolver(n, px.data(), pb.data(), PA)->solve();
+	undo(x, px.data());
+}
+
+}
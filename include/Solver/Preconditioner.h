@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+
+namespace Solver {
+
+/*
+preconditioner with a setup / apply split, for preconditioners that depend on the state being linearized about
+
+JFNK calls setup(x, F_of_x) once per newton step, before the linear solve, and the linear solver calls apply() every iteration,
+so that assembling and factoring a physics-based approximate Jacobian at x happens once per step instead of once per application,
+and apply() never has to guess whether x changed.
+
+usable as Krylov::MInv via getMInv(), which references this object.
+*/
+template<typename real>
+struct Preconditioner {
+	using Func = std::function<void(real* y, const real* x)>;
+
+	virtual ~Preconditioner();
+
+	/*
+	x = the state, F_of_x = F(x), both size n, only valid for the duration of the call
+	with a JFNK nonlinearPreconditioner F_of_x is G(x), the function newton is applied to
+	default does nothing
+	*/
+	virtual void setup(const real* x, const real* F_of_x);
+
+	//y = MInv(r).  y and r can be the same memory
+	virtual void apply(real* y, const real* r) = 0;
+
+	Func getMInv() { return [this](real* y, const real* r) { apply(y, r); }; }
+};
+
+}
+
+
+namespace Solver {
+
+template<typename real>
+Preconditioner<real>::~Preconditioner() {}
+
+template<typename real>
+void Preconditioner<real>::setup(const real*, const real*) {}
+
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Solver/Index.h"
+#include "Solver/ScalarTraits.h"
+#include "Solver/Sketch.h"
+#include <vector>
+#include <memory>
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+sketch-and-precondition least squares, min |a x - b| for a tall dense a
+Avron, Maymounkov, Toledo (2010). "Blendenpik: Supercharging LAPACK's Least-Squares Solver." SIAM Journal on Scientific Computing vol. 32 no. 3
+Meng, Saunders, Mahoney (2014). "LSRN: A Parallel Iterative Solver for Strongly Over- or Underdetermined Systems." SIAM Journal on Scientific Computing vol. 36 no. 2
+
+the constructor sketches a down to sketchFactor * n rows and QR-factors the sketch with HouseholderQR.
+the R of the sketch makes a R^-1 well-conditioned independent of a's own conditioning,
+so each solve() is LSQR on a R^-1, which converges to epsilon in a few dozen iterations, each one multiply by a and one by a^H.
+setup is O(nnzPerColumn m n + n^3) instead of HouseholderQR::solveLinear_leastSquares's O(m^2 n), and the factorization is reused for every b.
+
+a is m * n column-major, m >= n, full column rank.  it isn't copied, and has to outlive this object.
+*/
+template<typename real>
+struct RandomizedLeastSquares {
+	using Magnitude = typename ScalarTraits<real>::Magnitude;
+	using Traits = ScalarTraits<real>;
+
+	/*
+	sketchFactor = sketch rows per column of a.  4 is the usual choice.
+	sketch = optional, from m to at least n rows.  default a SparseSignSketch with sketchFactor * n rows.
+	*/
+	RandomizedLeastSquares(
+		size_t m,
+		size_t n,
+		const real* a,
+		Magnitude epsilon = 1e-12,
+		int maxiter = -1,
+		size_t sketchFactor = 4,
+		std::shared_ptr<Sketch<real>> sketch = nullptr);
+
+	/*
+	x = argmin |a x - b|
+	b is size m, x is size n
+	*/
+	void solve(real* x, const real* b);
+
+	/*
+	Paige, Saunders (1982). "LSQR: An Algorithm for Sparse Linear Equations and Sparse Least Squares." ACM Transactions on Mathematical Software vol. 8 no. 1
+	stops once |(a R^-1)^H r| <= epsilon |r|, i.e. r is numerically orthogonal to the columns of a, which for a R^-1 near orthonormal is the relative optimality,
+	or once |r| <= epsilon |b| for a consistent system.  default maxiter = n.
+	*/
+	Magnitude epsilon;
+	int maxiter;
+
+	int getIter() const { return iter; }
+
+	//|a x - b| estimated by LSQR
+	Magnitude getResidual() const { return residual; }
+
+protected:
+	size_t m;
+	size_t n;
+	const real* a;
+
+	size_t sketchRows;
+	std::vector<real> r;	//[sketchRows,n] the QR'd sketch, R in its upper n * n
+
+	int iter;
+	Magnitude residual;
+
+	//y[n] = a^H x[m]
+	void applyAH(real* y, const real* x) const;
+	//x = R^-1 x
+	void solveR(real* x) const;
+	//x = R^-H x
+	void solveRH(real* x) const;
+};
+
+}
+
+
+#include "Solver/DenseInverse.h"
+#include "Solver/Vector.h"
+#include "Solver/Math.h"
+#include "Common/Exception.h"
+#include <string.h>	//memset, memcpy
+
+namespace Solver {
+
+template<typename real>
+RandomizedLeastSquares<real>::RandomizedLeastSquares(size_t m_, size_t n_, const real* a_, Magnitude epsilon_, int maxiter_, size_t sketchFactor, std::shared_ptr<Sketch<real>> sketch)
+: epsilon(epsilon_)
+, maxiter(maxiter_)
+, m(m_)
+, n(n_)
+, a(a_)
+, iter(0)
+, residual(0)
+{
+	if (m < n) throw Common::Exception() << "least squares needs m >= n, got " << m << " x " << n;
+	if (maxiter == -1) maxiter = n;
+	if (!sketch) sketch = std::make_shared<SparseSignSketch<real>>(m, sketchFactor * n < m ? sketchFactor * n : m);
+	if (sketch->getN() != m) throw Common::Exception() << "sketch size " << sketch->getN() << " doesn't match " << m << " rows";
+	sketchRows = sketch->getK();
+	if (sketchRows < n) throw Common::Exception() << "sketch has " << sketchRows << " rows, fewer than the " << n << " columns";
+
+	//r = QR of the sketch of a, column by column
+	r.resize(sketchRows * n);
+	for (Index j = 0; j < (Index)n; ++j) {
+		sketch->apply(r.data() + sketchRows * j, a + m * j);
+	}
+	HouseholderQR<real>().householderQR(sketchRows, n, nullptr, r.data());
+}
+
+template<typename real>
+void RandomizedLeastSquares<real>::applyAH(real* y, const real* x) const {
+	for (Index j = 0; j < (Index)n; ++j) {
+		y[j] = Vector<real>::dot(m, a + m * j, x);
+	}
+}
+
+template<typename real>
+void RandomizedLeastSquares<real>::solveR(real* x) const {
+	DenseInverse<real>().backSubstituteUpperTriangular(sketchRows, n, x, r.data(), x);
+}
+
+template<typename real>
+void RandomizedLeastSquares<real>::solveRH(real* x) const {
+	//forward substitution with the lower-triangular R^H
+	for (Index i = 0; i < (Index)n; ++i) {
+		real sum = x[i];
+		for (Index j = 0; j < i; ++j) {
+			sum -= Traits::conj(r[j + sketchRows * i]) * x[j];
+		}
+		x[i] = sum / Traits::conj(r[i + sketchRows * i]);
+	}
+}
+
+template<typename real>
+void RandomizedLeastSquares<real>::solve(real* x, const real* b) {
+	//LSQR on M = a R^-1 for y = R x
+	std::vector<real> u(m);
+	std::vector<real> v(n);
+	std::vector<real> w(n);
+	std::vector<real> tmp(n);
+	memset((void*)x, 0, sizeof(real) * n);	//y, until x = R^-1 y at the end
+
+	//beta u = b, alpha v = M^H u
+	memcpy((void*)u.data(), b, sizeof(real) * m);
+	Magnitude beta = Vector<real>::normL2(m, u.data());
+	Magnitude bNormL2 = beta;
+	iter = 0;
+	residual = beta;
+	if (beta == 0) return;
+	for (Index i = 0; i < (Index)m; ++i) {
+		u[i] /= beta;
+	}
+	applyAH(v.data(), u.data());
+	solveRH(v.data());
+	Magnitude alpha = Vector<real>::normL2(n, v.data());
+	if (alpha == 0) return;
+	for (Index j = 0; j < (Index)n; ++j) {
+		v[j] /= alpha;
+		w[j] = v[j];
+	}
+
+	Magnitude phiBar = beta;
+	Magnitude rhoBar = alpha;
+	for (iter = 1; iter <= maxiter; ++iter) {
+		//beta u = M v - alpha u = a (R^-1 v) - alpha u
+		for (Index j = 0; j < (Index)n; ++j) {
+			tmp[j] = v[j];
+		}
+		solveR(tmp.data());
+		for (Index i = 0; i < (Index)m; ++i) {
+			u[i] *= -alpha;
+		}
+		for (Index j = 0; j < (Index)n; ++j) {
+			real tj = tmp[j];
+			const real* aj = a + m * j;
+			for (Index i = 0; i < (Index)m; ++i) {
+				u[i] += aj[i] * tj;
+			}
+		}
+		beta = Vector<real>::normL2(m, u.data());
+		if (beta != 0) {
+			for (Index i = 0; i < (Index)m; ++i) {
+				u[i] /= beta;
+			}
+		}
+
+		//alpha v = M^H u - beta v
+		applyAH(tmp.data(), u.data());
+		solveRH(tmp.data());
+		for (Index j = 0; j < (Index)n; ++j) {
+			v[j] = tmp[j] - v[j] * beta;
+		}
+		alpha = Vector<real>::normL2(n, v.data());
+		if (alpha != 0) {
+			for (Index j = 0; j < (Index)n; ++j) {
+				v[j] /= alpha;
+			}
+		}
+
+		//plane rotation eliminating beta from the lower bidiagonal
+		Magnitude rho = sqrt(rhoBar * rhoBar + beta * beta);
+		Magnitude c = rhoBar / rho;
+		Magnitude s = beta / rho;
+		Magnitude theta = s * alpha;
+		rhoBar = -c * alpha;
+		Magnitude phi = c * phiBar;
+		phiBar = s * phiBar;
+
+		//y += (phi / rho) w, w = v - (theta / rho) w
+		for (Index j = 0; j < (Index)n; ++j) {
+			x[j] += w[j] * (phi / rho);
+			w[j] = v[j] - w[j] * (theta / rho);
+		}
+
+		//|r| = phiBar, |M^H r| = phiBar alpha |c|
+		residual = phiBar;
+		if (phiBar <= epsilon * bNormL2) break;
+		if (alpha * fabs(c) <= epsilon) break;
+	}
+
+	//x = R^-1 y
+	solveR(x);
+}
+
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "Solver/Index.h"
+#include "Solver/ScalarTraits.h"
+#include <functional>
+#include <stdint.h>	//uint64_t
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+randomized range finder and truncated SVD of an m * n operator given only its products
+Halko, Martinsson, Tropp (2011). "Finding Structure with Randomness: Probabilistic Algorithms for Constructing Approximate Matrix Decompositions." SIAM Review vol. 53 no. 2
+
+the range finder applies A to rank + oversample Gaussian vectors and orthonormalizes the result with HouseholderQR.
+each power iteration then multiplies the basis by A A^H, re-orthonormalizing in between,
+which sharpens it towards the dominant singular vectors when the spectrum decays slowly.
+svd() projects A onto the basis, B = Q^H A, takes the SVD of the small B with one-sided Jacobi,
+and lifts its left vectors back by Q.
+
+the cost is (rank + oversample) (2 powerIterations + 2) operator products plus O((m + n) (rank + oversample)^2),
+so O(m n rank) for a dense operator, against O(m n min(m, n)) for a full SVD.
+the same seed gives the same factorization.
+*/
+template<typename real>
+struct RandomizedSVD {
+	using Func = std::function<void(real* y, const real* x)>;
+	using Magnitude = typename ScalarTraits<real>::Magnitude;
+	using Traits = ScalarTraits<real>;
+
+	/*
+	A = y[m] = A x[n]
+	AH = y[n] = A^H x[m].  only the range finder without power iterations can do without it.
+	rank = number of singular triplets svd() returns
+	oversample = extra samples beyond rank.  5 to 10 is the usual choice.
+	*/
+	RandomizedSVD(
+		size_t m,
+		size_t n,
+		Func A,
+		Func AH,
+		size_t rank,
+		size_t oversample = 10,
+		int powerIterations = 2,
+		uint64_t seed = 0);
+
+	Func A;
+	Func AH;
+	int powerIterations;
+
+	//l = min(rank + oversample, m, n), the number of samples
+	size_t getSampleSize() const { return sampleSize; }
+
+	//q[m, l] = orthonormal basis approximating the range of A
+	void rangeFinder(real* q);
+
+	/*
+	A ~= u diag(s) v^H
+	u is [m, rank], s is [rank] in decreasing order, v is [n, rank]
+	*/
+	void svd(real* u, Magnitude* s, real* v);
+
+	/*
+	one-sided Jacobi SVD of a tall c[n, l], n >= l
+	Hestenes (1958). "Inversion of Matrices by Biorthogonalization and Related Results." Journal of the Society for Industrial and Applied Mathematics vol. 6 no. 1
+	on output c = u, the left singular vectors, s = the singular values in decreasing order, w[l, l] = the right singular vectors,
+	so that c on input = u diag(s) w^H
+	*/
+	static void jacobiSVD(size_t n, size_t l, real* c, Magnitude* s, real* w);
+
+protected:
+	size_t m;
+	size_t n;
+	size_t rank;
+	size_t sampleSize;
+	uint64_t seed;
+
+	//y[:, j] = f(x[:, j]) for j < l, y has yRows rows, x has xRows rows
+	void applyColumns(const Func& f, real* y, size_t yRows, const real* x, size_t xRows);
+};
+
+}
+
+
+#include "Solver/DenseInverse.h"
+#include "Solver/Vector.h"
+#include "Solver/Math.h"
+#include "Common/Exception.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace Solver {
+
+template<typename real>
+RandomizedSVD<real>::RandomizedSVD(size_t m_, size_t n_, Func A_, Func AH_, size_t rank_, size_t oversample, int powerIterations_, uint64_t seed_)
+: A(A_)
+, AH(AH_)
+, powerIterations(powerIterations_)
+, m(m_)
+, n(n_)
+, rank(rank_)
+, sampleSize(std::min(rank_ + oversample, std::min(m_, n_)))
+, seed(seed_)
+{
+	if (!rank) throw Common::Exception() << "RandomizedSVD needs a rank of at least 1";
+	if (rank > sampleSize) throw Common::Exception() << "rank " << rank << " exceeds the " << m << " x " << n << " operator";
+}
+
+template<typename real>
+void RandomizedSVD<real>::applyColumns(const Func& f, real* y, size_t yRows, const real* x, size_t xRows) {
+	for (Index j = 0; j < (Index)sampleSize; ++j) {
+		f(y + yRows * j, x + xRows * j);
+	}
+}
+
+template<typename real>
+void RandomizedSVD<real>::rangeFinder(real* q) {
+	size_t l = sampleSize;
+	if (powerIterations > 0 && !AH) throw Common::Exception() << "power iterations need AH";
+
+	//q = orth(A omega), omega[n, l] Gaussian
+	std::vector<real> z(n * l);
+	std::mt19937_64 rng(seed);
+	std::normal_distribution<double> normal;
+	for (auto& zi : z) {
+		zi = real(Magnitude(normal(rng)));
+	}
+	applyColumns(A, q, m, z.data(), n);
+	HouseholderQR<real>().orthonormalize(m, l, q);
+
+	//q = orth(A orth(A^H q))
+	for (int iter = 0; iter < powerIterations; ++iter) {
+		applyColumns(AH, z.data(), n, q, m);
+		HouseholderQR<real>().orthonormalize(n, l, z.data());
+		applyColumns(A, q, m, z.data(), n);
+		HouseholderQR<real>().orthonormalize(m, l, q);
+	}
+}
+
+template<typename real>
+void RandomizedSVD<real>::svd(real* u, Magnitude* s, real* v) {
+	size_t l = sampleSize;
+	if (!AH) throw Common::Exception() << "svd needs AH";
+
+	std::vector<real> q(m * l);
+	rangeFinder(q.data());
+
+	//B^H = A^H q = ub diag(sb) w^H, so A ~= q B = (q w) diag(sb) ub^H
+	std::vector<real> bh(n * l);
+	applyColumns(AH, bh.data(), n, q.data(), m);
+	std::vector<Magnitude> sb(l);
+	std::vector<real> w(l * l);
+	jacobiSVD(n, l, bh.data(), sb.data(), w.data());
+
+	for (Index j = 0; j < (Index)rank; ++j) {
+		s[j] = sb[j];
+		for (Index i = 0; i < (Index)n; ++i) {
+			v[i + n * j] = bh[i + n * j];
+		}
+		real* uj = u + m * j;
+		for (Index i = 0; i < (Index)m; ++i) {
+			uj[i] = 0;
+		}
+		for (Index k = 0; k < (Index)l; ++k) {
+			real wkj = w[k + l * j];
+			const real* qk = q.data() + m * k;
+			for (Index i = 0; i < (Index)m; ++i) {
+				uj[i] += qk[i] * wkj;
+			}
+		}
+	}
+}
+
+template<typename real>
+void RandomizedSVD<real>::jacobiSVD(size_t n, size_t l, real* c, Magnitude* s, real* w) {
+	const int maxSweeps = 30;
+	const Magnitude tolerance = Magnitude((double)n) * std::numeric_limits<Magnitude>::epsilon();
+
+	for (Index j = 0; j < (Index)l; ++j) {
+		for (Index i = 0; i < (Index)l; ++i) {
+			w[i + l * j] = i == j ? 1 : 0;
+		}
+	}
+
+	//rotate column pairs of c until all are orthogonal, accumulating the rotations in w
+	for (int sweep = 0; sweep < maxSweeps; ++sweep) {
+		bool rotated = false;
+		for (Index p = 0; p < (Index)l; ++p) {
+			for (Index q = p+1; q < (Index)l; ++q) {
+				real* cp = c + n * p;
+				real* cq = c + n * q;
+				Magnitude alpha = Traits::realPart(Vector<real>::dot(n, cp, cp));
+				Magnitude beta = Traits::realPart(Vector<real>::dot(n, cq, cq));
+				real gamma = Vector<real>::dot(n, cp, cq);
+				Magnitude gammaAbs = Traits::abs(gamma);
+				if (gammaAbs == 0 || gammaAbs <= tolerance * sqrt(alpha * beta)) continue;
+				rotated = true;
+
+				//with phase = gamma / |gamma|, the real rotation of cp and conj(phase) cq that zeroes their inner product
+				real phase = gamma / gammaAbs;
+				Magnitude zeta = (beta - alpha) / (Magnitude(2) * gammaAbs);
+				Magnitude t = Magnitude(zeta >= 0 ? 1 : -1) / (fabs(zeta) + sqrt(Magnitude(1) + zeta * zeta));
+				Magnitude cs = Magnitude(1) / sqrt(Magnitude(1) + t * t);
+				Magnitude sn = cs * t;
+				real phaseConj = Traits::conj(phase);
+				for (Index i = 0; i < (Index)n; ++i) {
+					real xp = cp[i];
+					real xq = cq[i];
+					cp[i] = xp * cs - phaseConj * xq * sn;
+					cq[i] = phase * xp * sn + xq * cs;
+				}
+				real* wp = w + l * p;
+				real* wq = w + l * q;
+				for (Index i = 0; i < (Index)l; ++i) {
+					real xp = wp[i];
+					real xq = wq[i];
+					wp[i] = xp * cs - phaseConj * xq * sn;
+					wq[i] = phase * xp * sn + xq * cs;
+				}
+			}
+		}
+		if (!rotated) break;
+	}
+
+	//singular values are the column norms.  sort decreasing and normalize the columns of c
+	std::vector<Magnitude> norms(l);
+	std::vector<Index> order(l);
+	for (Index j = 0; j < (Index)l; ++j) {
+		norms[j] = Vector<real>::normL2(n, c + n * j);
+		order[j] = j;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](Index a, Index b) { return norms[b] < norms[a]; });
+
+	std::vector<real> cCopy(c, c + n * l);
+	std::vector<real> wCopy(w, w + l * l);
+	for (Index j = 0; j < (Index)l; ++j) {
+		Index k = order[j];
+		s[j] = norms[k];
+		Magnitude scale = norms[k] > 0 ? Magnitude(1) / norms[k] : Magnitude(0);
+		for (Index i = 0; i < (Index)n; ++i) {
+			c[i + n * j] = cCopy[i + n * k] * scale;
+		}
+		for (Index i = 0; i < (Index)l; ++i) {
+			w[i + l * j] = wCopy[i + l * k];
+		}
+	}
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Solver/Math.h"
+#include <complex>
+
+namespace Solver {
+
+/*
+what the solvers need to know about their scalar type to handle real and complex alike
+Magnitude = the real type of norms, residuals, tolerances and radii
+for real types every function here is the identity / plain arithmetic, so real results are unchanged
+*/
+template<typename real>
+struct ScalarTraits {
+	using Magnitude = real;
+	static constexpr bool isComplex = false;
+	static real conj(const real& x) { return x; }
+	static Magnitude realPart(const real& x) { return x; }
+	static Magnitude abs(const real& x) { return fabs(x); }
+	static Magnitude abs2(const real& x) { return x * x; }
+	//x / |x|, with sign(0) = 1
+	static real sign(const real& x) { return x < 0 ? -1 : 1; }
+};
+
+template<typename T>
+struct ScalarTraits<std::complex<T>> {
+	using real = std::complex<T>;
+	using Magnitude = T;
+	static constexpr bool isComplex = true;
+	static real conj(const real& x) { return std::conj(x); }
+	static Magnitude realPart(const real& x) { return x.real(); }
+	static Magnitude abs(const real& x) { return std::abs(x); }
+	static Magnitude abs2(const real& x) { return std::norm(x); }
+	static real sign(const real& x) {
+		Magnitude xAbs = std::abs(x);
+		return xAbs == 0 ? real(1) : x / xAbs;
+	}
+};
+
+}
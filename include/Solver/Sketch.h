@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Solver/Index.h"
+#include "Solver/ScalarTraits.h"
+#include <vector>
+#include <stdint.h>	//uint64_t, uint32_t
+#include <stdlib.h>	//size_t
+
+namespace Solver {
+
+/*
+random linear map Theta from n to k << n dimensions that approximately preserves the L2 norms of any fixed low-dimensional subspace:
+(1 - eps) |x| <= |Theta x| <= (1 + eps) |x| for every x in it, with high probability once k is a small multiple of its dimension.
+randomized solvers do their orthogonalization and least-squares work on Theta x instead of x.
+*/
+template<typename real>
+struct Sketch {
+	Sketch(size_t n, size_t k);
+	virtual ~Sketch();
+
+	//y[k] = Theta x[n]
+	virtual void apply(real* y, const real* x) const = 0;
+
+	size_t getN() const { return n; }
+	size_t getK() const { return k; }
+
+protected:
+	size_t n;
+	size_t k;
+};
+
+/*
+sparse sign embedding
+Meng, Mahoney (2013). "Low-distortion subspace embeddings in input-sparsity time and applications to robust linear regression." STOC 2013
+Tropp, Yurtsever, Udell, Cevher (2019). "Streaming Low-Rank Matrix Approximation with an Application to Scientific Simulation." SIAM Journal on Scientific Computing vol. 41 no. 4
+
+each column of Theta has nnzPerColumn entries of +-1/sqrt(nnzPerColumn) in distinct random rows,
+so applying it costs nnzPerColumn * n, independent of k.  8 nonzeros per column is the usual choice.
+entries are stored as 32-bit row * 2 + sign bit, so that streaming them costs less than streaming x.
+the same seed gives the same sketch.
+*/
+template<typename real>
+struct SparseSignSketch : public Sketch<real> {
+	using Super = Sketch<real>;
+	using Magnitude = typename ScalarTraits<real>::Magnitude;
+
+	SparseSignSketch(size_t n, size_t k, size_t nnzPerColumn = 8, uint64_t seed = 0);
+
+	virtual void apply(real* y, const real* x) const;
+
+protected:
+	size_t nnzPerColumn;
+	Magnitude scale;
+	std::vector<uint32_t> entries;	//[n * nnzPerColumn] row * 2 + 1 for a -1 entry
+};
+
+}
+
+
+#include "Solver/Math.h"
+#include "Common/Exception.h"
+#include <random>
+
+namespace Solver {
+
+template<typename real>
+Sketch<real>::Sketch(size_t n_, size_t k_)
+: n(n_)
+, k(k_)
+{}
+
+template<typename real>
+Sketch<real>::~Sketch() {}
+
+template<typename real>
+SparseSignSketch<real>::SparseSignSketch(size_t n_, size_t k_, size_t nnzPerColumn_, uint64_t seed)
+: Super(n_, k_)
+, nnzPerColumn(nnzPerColumn_ < k_ ? nnzPerColumn_ : k_)
+, scale(Magnitude(1) / sqrt(Magnitude((double)nnzPerColumn)))
+, entries(n_ * nnzPerColumn)
+{
+	if (!k_) throw Common::Exception() << "sketch needs at least one row";
+	if (k_ > (size_t)(UINT32_MAX >> 1)) throw Common::Exception() << "sketch has too many rows: " << k_;
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<uint32_t> row(0, (uint32_t)k_ - 1);
+	for (Index j = 0; j < (Index)n_; ++j) {
+		uint32_t* column = entries.data() + nnzPerColumn * j;
+		for (Index l = 0; l < (Index)nnzPerColumn; ++l) {
+			//distinct rows within the column
+			bool repeated;
+			do {
+				column[l] = row(rng) << 1;
+				repeated = false;
+				for (Index e = 0; e < l; ++e) {
+					if ((column[e] >> 1) == (column[l] >> 1)) repeated = true;
+				}
+			} while (repeated);
+			column[l] |= rng() & 1;
+		}
+	}
+}
+
+template<typename real>
+void SparseSignSketch<real>::apply(real* y, const real* x) const {
+	for (Index i = 0; i < (Index)this->k; ++i) {
+		y[i] = 0;
+	}
+	//accumulate +-x[j], picking the sign by lookup rather than a branch, then scale
+	for (Index j = 0; j < (Index)this->n; ++j) {
+		real signedX[2] = {x[j], -x[j]};
+		const uint32_t* column = entries.data() + nnzPerColumn * j;
+		for (Index l = 0; l < (Index)nnzPerColumn; ++l) {
+			uint32_t e = column[l];
+			y[e >> 1] += signedX[e & 1];
+		}
+	}
+	for (Index i = 0; i < (Index)this->k; ++i) {
+		y[i] *= scale;
+	}
+}
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Solver/GMRES.h"
+#include "Solver/Sketch.h"
+#include <memory>
+
+namespace Solver {
+
+/*
+GMRES with randomized Gram-Schmidt
+Balabanov, Grigori (2022). "Randomized Gram-Schmidt Process with Application to GMRES." SIAM Journal on Scientific Computing vol. 44 no. 3
+
+the basis is made orthonormal in the sketched inner product <Theta x, Theta y> instead of the L2 one:
+the projection coefficients of each new vector come from Gram-Schmidt among the k-dimensional sketches,
+so a step costs one pass over the basis to subtract them and two sketches,
+in place of the i+1 n-length reductions and the pass of classical Gram-Schmidt.
+the Arnoldi relation A V = V H still holds exactly and Theta V is orthonormal,
+so the usual Givens least-squares minimizes the sketched residual |Theta r|, which is within the sketch's distortion of |r|.
+residuals between restarts are the sketched ones, restart residuals are true L2 norms.
+trustRadius is also measured in the sketched norm.
+
+the savings grow with the restart length.
+the sketch needs k comfortably above restart + 1 rows to stay an embedding of the whole basis.
+*/
+template<typename real>
+struct SketchedGMRES : public GMRES<real> {
+	using Super = GMRES<real>;
+
+	using Func = typename Super::Func;
+	using Magnitude = typename Super::Magnitude;
+	using Traits = ScalarTraits<real>;
+
+	SketchedGMRES(
+		size_t n,
+		real* x,
+		const real* b,
+		Func A,
+		Magnitude epsilon = 1e-7,
+		int maxiter = -1,
+		int restart = -1,
+		std::shared_ptr<Allocator<real>> allocator = nullptr);
+	virtual ~SketchedGMRES();
+
+	//optional.  default SparseSignSketch from n to getDefaultSketchSize(restart) rows, created on the first solve().  set it before then.
+	std::shared_ptr<Sketch<real>> sketch;
+
+	static size_t getDefaultSketchSize(size_t restart) { return 4 * (restart + 1); }
+
+	//elements of WorkspaceAllocator space solve() needs with the default sketch.  restart = -1 means n, same as the constructor.
+	static size_t getWorkspaceSize(size_t n, int restart = -1);
+
+	virtual size_t getMemoryFootprint() const;
+
+protected:
+	size_t sketchSize;	//k of the sketch the buffers were sized for
+	real* S;		//[k,m+1] sketched basis, Theta v
+	real* p;		//[k] sketch of the vector being orthogonalized
+
+	virtual void allocateBuffers();
+	virtual void freeBuffers();
+
+	virtual Magnitude arnoldiStep(Index i);
+};
+
+}
+
+
+#include "Solver/Vector.h"
+#include "Solver/Math.h"
+#include "Common/Exception.h"
+
+namespace Solver {
+
+template<typename real>
+SketchedGMRES<real>::SketchedGMRES(size_t n, real* x, const real* b, Func A, Magnitude epsilon, int maxiter, int restart, std::shared_ptr<Allocator<real>> allocator)
+: Super(n, x, b, A, epsilon, maxiter, restart, allocator)
+, sketchSize(0)
+, S(nullptr)
+, p(nullptr)
+{}
+
+template<typename real>
+SketchedGMRES<real>::~SketchedGMRES() {
+	freeBuffers();
+}
+
+template<typename real>
+size_t SketchedGMRES<real>::getWorkspaceSize(size_t n, int restart) {
+	size_t m = restart == -1 ? n : restart;
+	size_t k = getDefaultSketchSize(m);
+	return Super::getWorkspaceSize(n, restart)
+		+ WorkspaceAllocator<real>::getAllocationSize(k * (m + 1))	//S
+		+ WorkspaceAllocator<real>::getAllocationSize(k);	//p
+}
+
+template<typename real>
+void SketchedGMRES<real>::allocateBuffers() {
+	Super::allocateBuffers();
+	if (!sketch) sketch = std::make_shared<SparseSignSketch<real>>(this->n, getDefaultSketchSize(this->restart));
+	if (sketch->getN() != this->n) throw Common::Exception() << "sketch size " << sketch->getN() << " doesn't match problem size " << this->n;
+	sketchSize = sketch->getK();
+	S = this->buffersAllocator->allocate(sketchSize * (this->restart + 1), "SketchedGMRES S");
+	p = this->buffersAllocator->allocate(sketchSize, "SketchedGMRES p");
+}
+
+template<typename real>
+size_t SketchedGMRES<real>::getMemoryFootprint() const {
+	if (!S) return Super::getMemoryFootprint();
+	return Super::getMemoryFootprint() + sizeof(real) * (sketchSize * (this->restart + 1)	//S
+		+ sketchSize);	//p
+}
+
+template<typename real>
+void SketchedGMRES<real>::freeBuffers() {
+	if (this->buffersAllocator && S) {
+		this->buffersAllocator->deallocate(p, sketchSize);
+		this->buffersAllocator->deallocate(S, sketchSize * (this->restart + 1));
+	}
+	S = p = nullptr;
+	Super::freeBuffers();
+}
+
+template<typename real>
+typename SketchedGMRES<real>::Magnitude SketchedGMRES<real>::arnoldiStep(Index i) {
+	size_t n = this->n;
+	size_t k = sketchSize;
+	Index m = this->restart;
+	real* v = this->v;
+	real* w = this->w;
+	real* h = this->h;
+
+	//v[0] = r / |r| from GMRES is rescaled to unit sketched norm, and beta = s[0] with it
+	if (i == 0) {
+		if (sketch->getK() != k) throw Common::Exception() << "sketch was changed after the first solve()";
+		sketch->apply(S, v);
+		Magnitude scale = Vector<real>::normL2(k, S);
+		for (Index l = 0; l < (Index)n; ++l) {
+			v[l] /= scale;
+		}
+		for (Index l = 0; l < (Index)k; ++l) {
+			S[l] /= scale;
+		}
+		this->s[0] *= scale;
+	}
+
+	//w = MInv(A(v[i]))
+	this->applyOperator(w, v + n * i);
+	if (this->MInv) this->MInv(w, w);
+
+	//h(0:i, i) = S(:, 0:i)^H Theta w, Gram-Schmidt twice in the sketched space
+	sketch->apply(p, w);
+	for (Index j = 0; j <= i; ++j) {
+		h[j + (m+1) * i] = 0;
+	}
+	for (int pass = 0; pass < 2; ++pass) {
+		for (Index j = 0; j <= i; ++j) {
+			real c = Vector<real>::dot(k, S + k * j, p);
+			h[j + (m+1) * i] += c;
+			for (Index l = 0; l < (Index)k; ++l) {
+				p[l] -= S[l + k * j] * c;
+			}
+		}
+	}
+
+	//w = w - v(:, 0:i) h(0:i, i), a block of w at a time so it stays in cache while the basis streams past once
+	const Index blockSize = 512;
+	for (Index begin = 0; begin < (Index)n; begin += blockSize) {
+		Index end = begin + blockSize < (Index)n ? begin + blockSize : (Index)n;
+		for (Index j = 0; j <= i; ++j) {
+			real c = h[j + (m+1) * i];
+			const real* vj = v + n * j;
+			for (Index l = begin; l < end; ++l) {
+				w[l] -= vj[l] * c;
+			}
+		}
+	}
+
+	//h[i+1][i] = |Theta w|, v[i+1] = w / |Theta w|
+	sketch->apply(p, w);
+	Magnitude wNorm = Vector<real>::normL2(k, p);
+	h[(i+1) + (m+1)*i] = wNorm;
+	if (wNorm != 0) {
+		for (Index l = 0; l < (Index)n; ++l) {
+			v[l + n * (i+1)] = w[l] / wNorm;
+		}
+		for (Index l = 0; l < (Index)k; ++l) {
+			S[l + k * (i+1)] = p[l] / wNorm;
+		}
+	}
+	return wNorm;
+}
+
+}
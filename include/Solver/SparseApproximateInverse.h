@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Solver/CSR.h"
+#include "Solver/Krylov.h"
+#include "Solver/Preconditioner.h"
+
+namespace Solver {
+
+/*
+factorized sparse approximate inverse, for symmetric positive-definite A
+Kolotilina, Yeremin (1993). "Factorized Sparse Approximate Inverse Preconditionings I. Theory." SIAM Journal on Matrix Analysis and Applications vol. 14 no. 1
+
+MInv = G^T G ~ A^-1, for G lower-triangular with the lower-triangular pattern of A
+each row of G is an independent small dense solve, run in parallel at construction
+applying is two SpMVs, split by rows across threads
+
+a Preconditioner: usable as Krylov::MInv via getMInv(), which references this object, or as JFNK's preconditioner.
+*/
+template<typename real>
+struct FSAI : public Preconditioner<real> {
+	using Func = typename Krylov<real>::Func;
+
+	//A must stay alive only for the duration of the constructor.  throws if any diagonal entry isn't positive.
+	FSAI(const CSR<real>& A, size_t numThreads = 0);
+
+	//y = G^T G x.  y and x can be the same memory
+	void operator()(real* y, const real* x);
+
+	//same as operator()
+	virtual void apply(real* y, const real* r) { (*this)(y, r); }
+
+	const CSR<real>& getG() const { return G; }
+
+	size_t numThreads;
+
+protected:
+	CSR<real> G;
+	CSR<real> GT;
+	std::vector<real> tmp;
+};
+
+/*
+sparse approximate inverse for general A, with the static pattern of A
+Grote, Huckle (1997). "Parallel Preconditioning with Sparse Approximate Inverses." SIAM Journal on Scientific Computing vol. 18 no. 3
+
+MInv = M ~ A^-1, whose row i minimizes |m_i^T A - e_i^T|_2 over the pattern of row i of A
+each row is an independent small least-squares problem, solved with HouseholderQR in parallel at construction
+applying is a single SpMV, split by rows across threads
+
+a Preconditioner: usable as Krylov::MInv via getMInv(), which references this object, or as JFNK's preconditioner.
+*/
+template<typename real>
+struct SPAI : public Preconditioner<real> {
+	using Func = typename Krylov<real>::Func;
+
+	//A must stay alive only for the duration of the constructor
+	SPAI(const CSR<real>& A, size_t numThreads = 0);
+
+	//y = M x.  y and x can be the same memory
+	void operator()(real* y, const real* x);
+
+	//same as operator()
+	virtual void apply(real* y, const real* r) { (*this)(y, r); }
+
+	const CSR<real>& getM() const { return M; }
+
+	size_t numThreads;
+
+protected:
+	CSR<real> M;
+	std::vector<real> tmp;
+};
+
+}
+
+
+#include "Solver/DenseInverse.h"
+#include "Solver/Parallel.h"
+#include "Common/Exception.h"
+#include <string.h>	//memcpy
+#include <math.h>
+#include <vector>
+
+namespace Solver {
+
+template<typename real>
+FSAI<real>::FSAI(const CSR<real>& A, size_t numThreads_)
+: numThreads(numThreads_)
+, G(A.rows, A.cols)
+, tmp(A.rows)
+{
+	size_t n = A.rows;
+
+	//G's pattern is the strict lower triangle of A, plus the diagonal whether or not A stores it
+	for (Index i = 0; i < (Index)n; ++i) {
+		for (Index k = A.rowOffsets[i]; k < A.rowOffsets[i+1]; ++k) {
+			if (A.colIndexes[k] < i) G.colIndexes.push_back(A.colIndexes[k]);
+		}
+		G.colIndexes.push_back(i);
+		G.rowOffsets[i+1] = (Index)G.colIndexes.size();
+	}
+	G.values.resize(G.colIndexes.size());
+
+	//for row i with pattern P, solve A[P,P] g = e_i, then scale g by 1/sqrt(g_i)
+	Parallel::forRange(n, numThreads, [&](size_t begin, size_t end) {
+		std::vector<real> a, e, g;
+		for (Index i = (Index)begin; i < (Index)end; ++i) {
+			Index offset = G.rowOffsets[i];
+			Index m = G.rowOffsets[i+1] - offset;
+			if (!(A.get(i, i) > 0)) {
+				throw Common::Exception() << "FSAI needs a positive diagonal, but row " << i << " has " << A.get(i, i);
+			}
+			const Index* P = G.colIndexes.data() + offset;
+			a.resize(m * m);
+			e.assign(m, 0);
+			g.resize(m);
+			for (Index c = 0; c < m; ++c) {
+				for (Index r = 0; r < m; ++r) {
+					a[r + m * c] = A.get(P[r], P[c]);
+				}
+			}
+			//the diagonal is last, since the pattern is sorted, lower-triangular and always includes it
+			e[m-1] = 1;
+			HouseholderQR<real>().solveLinear(m, g.data(), a.data(), e.data());
+			real scale = g[m-1] > 0 ? 1. / sqrt(g[m-1]) : 0;
+			for (Index r = 0; r < m; ++r) {
+				G.values[offset + r] = g[r] * scale;
+			}
+		}
+	});
+
+	GT = G.transpose();
+}
+
+template<typename real>
+void FSAI<real>::operator()(real* y, const real* x) {
+	G.mul(tmp.data(), x, numThreads);
+	GT.mul(y, tmp.data(), numThreads);
+}
+
+template<typename real>
+SPAI<real>::SPAI(const CSR<real>& A, size_t numThreads_)
+: numThreads(numThreads_)
+, M(A.rows, A.cols)
+, tmp(A.rows)
+{
+	size_t n = A.rows;
+	M.rowOffsets = A.rowOffsets;
+	M.colIndexes = A.colIndexes;
+	M.values.resize(A.getNNZ());
+
+	/*
+	row i of M has pattern J = the columns of row i of A
+	m_i^T A = e_i^T <=> A^T m_i = e_i
+	A^T restricted to the columns J is nonzero only on the rows I = the union of the columns of rows J of A
+	so solve the |I| x |J| least-squares problem B m = e_i restricted to I, for B[a,b] = A(J[b], I[a])
+	*/
+	Parallel::forRange(n, numThreads, [&](size_t begin, size_t end) {
+		std::vector<Index> whereInI(A.cols, -1);
+		std::vector<Index> I;
+		std::vector<real> B, e, m;
+		for (Index i = (Index)begin; i < (Index)end; ++i) {
+			Index offset = A.rowOffsets[i];
+			Index numJ = A.rowOffsets[i+1] - offset;
+			if (!numJ) continue;
+			const Index* J = A.colIndexes.data() + offset;
+
+			I.clear();
+			for (Index b = 0; b < numJ; ++b) {
+				for (Index k = A.rowOffsets[J[b]]; k < A.rowOffsets[J[b]+1]; ++k) {
+					Index col = A.colIndexes[k];
+					if (whereInI[col] == -1) {
+						whereInI[col] = (Index)I.size();
+						I.push_back(col);
+					}
+				}
+			}
+			Index numI = (Index)I.size();
+
+			if (numI < numJ) {
+				//underdetermined, fall back to Jacobi for this row
+				for (Index b = 0; b < numJ; ++b) {
+					real aii = A.get(i, i);
+					M.values[offset + b] = J[b] == i && aii != 0 ? 1. / aii : 0;
+				}
+			} else {
+				B.assign(numI * numJ, 0);
+				for (Index b = 0; b < numJ; ++b) {
+					for (Index k = A.rowOffsets[J[b]]; k < A.rowOffsets[J[b]+1]; ++k) {
+						B[whereInI[A.colIndexes[k]] + numI * b] = A.values[k];
+					}
+				}
+				e.assign(numI, 0);
+				if (whereInI[i] != -1) e[whereInI[i]] = 1;
+				m.resize(numJ);
+				HouseholderQR<real>().solveLinear_leastSquares(numI, numJ, m.data(), B.data(), e.data());
+				for (Index b = 0; b < numJ; ++b) {
+					M.values[offset + b] = m[b];
+				}
+			}
+
+			for (Index col : I) {
+				whereInI[col] = -1;
+			}
+		}
+	});
+}
+
+template<typename real>
+void SPAI<real>::operator()(real* y, const real* x) {
+	memcpy(tmp.data(), x, sizeof(real) * M.rows);
+	M.mul(y, tmp.data(), numThreads);
+}
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Solver/Krylov.h"
+
+namespace Solver {
+
+/*
+source:
+Freund (1993). "A Transpose-Free Quasi-Minimal Residual Algorithm for Non-Hermitian Linear Systems." SIAM Journal on Scientific Computing vol. 14 no. 2
+Saad (2003). "Iterative Methods for Sparse Linear Systems" 2nd ed., Algorithm 7.8
+
+needs no A^T, uses a constant 6 vectors of storage, and its quasi-residual decreases smoothly
+MInv is applied as a left preconditioner, in-place, same as GMRES
+*/
+template<typename real>
+struct TFQMR : public Krylov<real> {
+	using Super = Krylov<real>;
+	using Super::Super;
+	virtual void solve();
+
+	//elements of WorkspaceAllocator space solve() needs
+	static size_t getWorkspaceSize(size_t n);
+};
+
+}
+
+
+#include "Solver/Vector.h"
+#include "Solver/Expr.h"
+#include "Solver/Math.h"
+
+namespace Solver {
+
+template<typename real>
+size_t TFQMR<real>::getWorkspaceSize(size_t n) {
+	return WorkspaceAllocator<real>::getAllocationSize(n) * 6;
+}
+
+template<typename real>
+void TFQMR<real>::solve() {
+	size_t n = this->n;
+	Buffer<real> rStar_(this->allocator, n, "TFQMR rStar");
+	real* rStar = rStar_.data();	//shadow residual r0*, fixed as the initial residual
+	Buffer<real> w_(this->allocator, n, "TFQMR w");
+	real* w = w_.data();
+	Buffer<real> u_(this->allocator, n, "TFQMR u");
+	real* u = u_.data();
+	Buffer<real> v_(this->allocator, n, "TFQMR v");
+	real* v = v_.data();
+	Buffer<real> d_(this->allocator, n, "TFQMR d");
+	real* d = d_.data();
+	Buffer<real> Au_(this->allocator, n, "TFQMR Au");
+	real* Au = Au_.data();
+
+	//y = MInv(A(x))
+	auto applyA = [&](real* y, const real* x) {
+		this->A(y, x);
+		if (this->MInv) this->MInv(y, y);
+	};
+
+	size_t numThreads = this->numThreads;
+	auto xv = view(n, this->x);
+	auto bv = view(n, this->b);
+	auto rStarv = view(n, rStar);
+	auto wv = view(n, w);
+	auto uv = view(n, u);
+	auto vv = view(n, v);
+	auto dv = view(n, d);
+	auto Auv = view(n, Au);
+
+	auto bb = dot(bv, bv);
+	evalParallel(numThreads, bb);
+	real bNormL2 = sqrt((real)bb);
+
+	//r = MInv(b - A(x))
+	this->A(rStar, this->x);
+	evalParallel(numThreads, rStarv = bv - rStarv);
+	if (this->MInv) this->MInv(rStar, rStar);
+
+	auto rr = dot(rStarv, rStarv);
+	evalParallel(numThreads, rr);
+	real tau = sqrt((real)rr);
+	this->iter = 0;
+	this->residual = this->calcResidual(tau, bNormL2, rStar);
+
+	if (!this->stop()) {
+		//w = u = r0, v = Au = A(u), d = 0
+		evalParallel(numThreads, wv = rStarv, uv = rStarv);
+		applyA(Au, u);
+		evalParallel(numThreads, vv = Auv, dv = real(0));
+
+		real theta = 0;
+		real eta = 0;
+		real alpha = 0;
+		real rho = rr;
+
+		for (this->iter = 1; this->iter <= this->maxiter; ++this->iter) {
+			int m = this->iter - 1;
+			if (m % 2 == 0) {
+				auto sigma_ = dot(rStarv, vv);
+				evalParallel(numThreads, sigma_);
+				real sigma = sigma_;
+				if (sigma == 0) {
+					this->stopReason = Super::STOP_BREAKDOWN;
+					break;
+				}
+				alpha = rho / sigma;
+			} else {
+				//Au = A(u) for the u formed on the previous (even) step
+				applyA(Au, u);
+			}
+
+			//w = w - alpha A(u)
+			//d = u + (theta^2 eta / alpha) d
+			//and |w|^2, in one pass
+			real dScale = theta * theta * eta / alpha;
+			auto ww = dot(wv, wv);
+			evalParallel(numThreads, wv -= Auv * alpha, dv = uv + dv * dScale, ww);
+
+			theta = sqrt((real)ww) / tau;
+			real c = 1. / sqrt(1. + theta * theta);
+			tau *= theta * c;
+			eta = c * c * alpha;
+
+			//x = x + eta d
+			evalParallel(numThreads, xv += dv * eta);
+
+			//|r_m| <= sqrt(m+1) tau_m
+			this->residual = this->calcResidual(tau * sqrt((real)(m + 2)), bNormL2, w);
+			if (this->stop()) break;
+
+			if (m % 2 == 0) {
+				//u = u - alpha v
+				evalParallel(numThreads, uv -= vv * alpha);
+			} else {
+				auto nRho_ = dot(rStarv, wv);
+				evalParallel(numThreads, nRho_);
+				real nRho = nRho_;
+				if (nRho == 0) {
+					this->stopReason = Super::STOP_BREAKDOWN;
+					break;
+				}
+				real beta = nRho / rho;
+				rho = nRho;
+
+				//u = w + beta u
+				//v = A(u) + beta (A(uPrev) + beta v)
+				evalParallel(numThreads, uv = wv + uv * beta, vv = (Auv + vv * beta) * beta);
+				applyA(Au, u);
+				evalParallel(numThreads, vv += Auv);
+			}
+		}
+	}
+}
+
+}
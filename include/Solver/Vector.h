@@ -1,23 +1,61 @@
 #pragma once
 
-#include <cmath>
+#include "Solver/Index.h"
+#include "Solver/Blas.h"
+#include "Solver/ScalarTraits.h"
 #include <stdlib.h>	//size_t
 
 namespace Solver {
 
 template<typename real>
 struct Vector {
+	using Magnitude = typename ScalarTraits<real>::Magnitude;
+
 	static real dot(size_t n, const real* a, const real* b) {
+		if constexpr (Blas<real>::enabled) return Blas<real>::dot(n, a, b);
 		real s = 0;
-		for (int i = 0; i < (int)n; ++i) {
+		for (Index i = 0; i < (Index)n; ++i) {
 			s += a[i] * b[i];
 		}
 		return s;
 	}
 	
-	static real normL2(size_t n, const real* v) {
+	static Magnitude normL2(size_t n, const real* v) {
 		return sqrt(dot(n,v,v));
 	}
 };
 
+/*
+complex vectors, with the real and imaginary parts done in the underlying type
+std::complex's operator* has inf/nan recovery (__muldc3) that keeps these loops from vectorizing
+*/
+template<typename T>
+struct Vector<std::complex<T>> {
+	using real = std::complex<T>;
+	using Magnitude = T;
+
+	//sum conj(a) b
+	static real dot(size_t n, const real* a, const real* b) {
+		const T* ap = reinterpret_cast<const T*>(a);
+		const T* bp = reinterpret_cast<const T*>(b);
+		T sr = 0, si = 0;
+		for (Index i = 0; i < (Index)n; ++i) {
+			T ar = ap[2*i], ai = ap[2*i+1];
+			T br = bp[2*i], bi = bp[2*i+1];
+			sr += ar * br + ai * bi;
+			si += ar * bi - ai * br;
+		}
+		return real(sr, si);
+	}
+
+	static Magnitude normL2(size_t n, const real* v) {
+		const T* vp = reinterpret_cast<const T*>(v);
+		T s = 0;
+		for (Index i = 0; i < 2 * (Index)n; ++i) {
+			s += vp[i] * vp[i];
+		}
+		return sqrt(s);
+	}
+};
+
 }
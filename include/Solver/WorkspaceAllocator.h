@@ -0,0 +1,143 @@
+#pragma once
+
+#include "Solver/Allocator.h"
+
+namespace Solver {
+
+/*
+hands out caller-provided memory, so solvers can work in pinned / NUMA-placed / pooled buffers without copies
+
+a bump allocator: allocations are carved off the front of the workspace in order,
+each rounded up to alignment bytes (measured from the start of the workspace, so sizes don't depend on where it lives).
+deallocating the most recent allocation gives its space back, so the per-solve buffers of ConjGrad, ConjRes and TFQMR,
+which are released in reverse order, reuse the same workspace every solve.
+deallocations out of that order, i.e. a JFNK Buffer resized while the linear solver's buffers sit above it, leave a hole,
+which later allocations that fit are placed in first, and which merges with its neighbors and returns to the end of the workspace
+once everything above it is released.  a workspace that is only sized for LIFO use can still run out through fragmentation:
+getWorkspaceSize() assumes every buffer is allocated once.
+not thread-safe.
+
+use each solver's static getWorkspaceSize() to size the workspace.
+allocations are zeroed but otherwise not touched; placement and page size are the caller's business.
+throws if the workspace runs out.
+*/
+template<typename real>
+struct WorkspaceAllocator : public Allocator<real> {
+	using Super = Allocator<real>;
+
+	WorkspaceAllocator(real* data, size_t size);
+
+	virtual real* allocate(size_t n, const char* name = nullptr);
+	virtual void deallocate(real* p, size_t n);
+
+	//release everything
+	void reset();
+
+	size_t getSize() const { return size; }
+	size_t getUsed() const { return used; }
+
+	//bytes each allocation is rounded to
+	static constexpr size_t alignment = 64;
+
+	//elements of workspace an allocation of n elements consumes
+	static size_t getAllocationSize(size_t n);
+
+protected:
+	real* data;
+	size_t size;
+	size_t used;
+
+	//[offset, offset + size) ranges below used, deallocated out of order.  sorted by offset, never adjacent.
+	std::vector<std::pair<size_t, size_t>> holes;
+};
+
+}
+
+
+#include "Common/Exception.h"
+#include <algorithm>	//lower_bound
+#include <string.h>	//memset
+
+namespace Solver {
+
+template<typename real>
+WorkspaceAllocator<real>::WorkspaceAllocator(real* data_, size_t size_)
+: data(data_)
+, size(size_)
+, used(0)
+{}
+
+template<typename real>
+size_t WorkspaceAllocator<real>::getAllocationSize(size_t n) {
+	size_t bytes = sizeof(real) * n;
+	bytes = (bytes + alignment - 1) / alignment * alignment;
+	return (bytes + sizeof(real) - 1) / sizeof(real);
+}
+
+template<typename real>
+real* WorkspaceAllocator<real>::allocate(size_t n, const char* name) {
+	size_t allocationSize = getAllocationSize(n);
+	real* p = nullptr;
+	//first fit among the holes
+	for (auto i = holes.begin(); i != holes.end(); ++i) {
+		if (i->second < allocationSize) continue;
+		p = data + i->first;
+		i->first += allocationSize;
+		i->second -= allocationSize;
+		if (!i->second) holes.erase(i);
+		break;
+	}
+	if (!p) {
+		if (used + allocationSize > size) {
+			throw Common::Exception() << "workspace of " << size << " elements is out of space allocating " << n << " for " << (name ? name : "(unnamed)") << ", " << used << " already used";
+		}
+		p = data + used;
+		used += allocationSize;
+	}
+	memset((void*)p, 0, sizeof(real) * n);
+
+	typename Super::Allocation allocation;
+	if (name && (this->trackAllocations || this->reportCallback)) allocation.name = name;
+	allocation.bytes = sizeof(real) * n;
+	allocation.mappedBytes = sizeof(real) * allocationSize;
+	allocation.pages = Super::PAGES_DEFAULT;
+	this->recordAllocation(p, allocation);
+	return p;
+}
+
+template<typename real>
+void WorkspaceAllocator<real>::deallocate(real* p, size_t n) {
+	if (!p) return;
+	this->forgetAllocation(p);
+	size_t allocationSize = getAllocationSize(n);
+	size_t offset = p - data;
+
+	//insert as a hole, merging with its neighbors
+	auto i = std::lower_bound(holes.begin(), holes.end(), std::make_pair(offset, (size_t)0));
+	i = holes.insert(i, std::make_pair(offset, allocationSize));
+	if (i + 1 != holes.end() && i->first + i->second == (i + 1)->first) {
+		i->second += (i + 1)->second;
+		holes.erase(i + 1);
+	}
+	if (i != holes.begin() && (i - 1)->first + (i - 1)->second == i->first) {
+		(i - 1)->second += i->second;
+		holes.erase(i);
+	}
+
+	//a hole at the end goes back to the unused space
+	if (!holes.empty() && holes.back().first + holes.back().second == used) {
+		used = holes.back().first;
+		holes.pop_back();
+	}
+}
+
+template<typename real>
+void WorkspaceAllocator<real>::reset() {
+	std::lock_guard<std::mutex> lock(this->allocationsMutex);
+	this->numRecorded -= this->allocations.size();
+	this->allocations.clear();
+	holes.clear();
+	used = 0;
+}
+
+}
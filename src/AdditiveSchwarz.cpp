@@ -0,0 +1,8 @@
+#include "Solver/AdditiveSchwarz.h"
+
+namespace Solver {
+
+template struct AdditiveSchwarz<float>;
+template struct AdditiveSchwarz<double>;
+
+}
@@ -0,0 +1,24 @@
+#include "Solver/Allocator.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct Allocator<float>;
+template struct Allocator<double>;
+template struct Buffer<float>;
+template struct Buffer<double>;
+
+template struct Allocator<DoubleDouble>;
+template struct Buffer<DoubleDouble>;
+template struct Allocator<std::complex<float>>;
+template struct Buffer<std::complex<float>>;
+template struct Allocator<std::complex<double>>;
+template struct Buffer<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct Allocator<__float128>;
+template struct Buffer<__float128>;
+#endif
+
+}
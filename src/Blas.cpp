@@ -0,0 +1,213 @@
+#include "Solver/Blas.h"
+
+#if defined(SOLVER_USE_BLAS)
+
+#include "Common/Exception.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+/*
+Fortran BLAS / LAPACK symbols
+character arguments are followed by their hidden lengths, gfortran's convention, which C implementations ignore
+*/
+extern "C" {
+using Solver::BlasInt;
+
+float sdot_(const BlasInt* n, const float* x, const BlasInt* incx, const float* y, const BlasInt* incy);
+double ddot_(const BlasInt* n, const double* x, const BlasInt* incx, const double* y, const BlasInt* incy);
+void saxpy_(const BlasInt* n, const float* alpha, const float* x, const BlasInt* incx, float* y, const BlasInt* incy);
+void daxpy_(const BlasInt* n, const double* alpha, const double* x, const BlasInt* incx, double* y, const BlasInt* incy);
+void sgemv_(const char* trans, const BlasInt* m, const BlasInt* n, const float* alpha, const float* a, const BlasInt* lda, const float* x, const BlasInt* incx, const float* beta, float* y, const BlasInt* incy, size_t);
+void dgemv_(const char* trans, const BlasInt* m, const BlasInt* n, const double* alpha, const double* a, const BlasInt* lda, const double* x, const BlasInt* incx, const double* beta, double* y, const BlasInt* incy, size_t);
+void strsv_(const char* uplo, const char* trans, const char* diag, const BlasInt* n, const float* a, const BlasInt* lda, float* x, const BlasInt* incx, size_t, size_t, size_t);
+void dtrsv_(const char* uplo, const char* trans, const char* diag, const BlasInt* n, const double* a, const BlasInt* lda, double* x, const BlasInt* incx, size_t, size_t, size_t);
+
+void sgeqrf_(const BlasInt* m, const BlasInt* n, float* a, const BlasInt* lda, float* tau, float* work, const BlasInt* lwork, BlasInt* info);
+void dgeqrf_(const BlasInt* m, const BlasInt* n, double* a, const BlasInt* lda, double* tau, double* work, const BlasInt* lwork, BlasInt* info);
+void sormqr_(const char* side, const char* trans, const BlasInt* m, const BlasInt* n, const BlasInt* k, const float* a, const BlasInt* lda, const float* tau, float* c, const BlasInt* ldc, float* work, const BlasInt* lwork, BlasInt* info, size_t, size_t);
+void dormqr_(const char* side, const char* trans, const BlasInt* m, const BlasInt* n, const BlasInt* k, const double* a, const BlasInt* lda, const double* tau, double* c, const BlasInt* ldc, double* work, const BlasInt* lwork, BlasInt* info, size_t, size_t);
+void sgetrf_(const BlasInt* m, const BlasInt* n, float* a, const BlasInt* lda, BlasInt* ipiv, BlasInt* info);
+void dgetrf_(const BlasInt* m, const BlasInt* n, double* a, const BlasInt* lda, BlasInt* ipiv, BlasInt* info);
+void sgetrs_(const char* trans, const BlasInt* n, const BlasInt* nrhs, const float* a, const BlasInt* lda, const BlasInt* ipiv, float* b, const BlasInt* ldb, BlasInt* info, size_t);
+void dgetrs_(const char* trans, const BlasInt* n, const BlasInt* nrhs, const double* a, const BlasInt* lda, const BlasInt* ipiv, double* b, const BlasInt* ldb, BlasInt* info, size_t);
+void spotrf_(const char* uplo, const BlasInt* n, float* a, const BlasInt* lda, BlasInt* info, size_t);
+void dpotrf_(const char* uplo, const BlasInt* n, double* a, const BlasInt* lda, BlasInt* info, size_t);
+void spotrs_(const char* uplo, const BlasInt* n, const BlasInt* nrhs, const float* a, const BlasInt* lda, float* b, const BlasInt* ldb, BlasInt* info, size_t);
+void dpotrs_(const char* uplo, const BlasInt* n, const BlasInt* nrhs, const double* a, const BlasInt* lda, double* b, const BlasInt* ldb, BlasInt* info, size_t);
+}
+
+namespace Solver {
+
+static const BlasInt one = 1;
+
+//largest size a BlasInt holds: 2^31-1 unless SOLVER_BLAS_ILP64
+static const size_t maxBlasSize = (size_t)std::numeric_limits<BlasInt>::max();
+
+//a size as a BlasInt, throwing instead of truncating
+static BlasInt toBlasInt(size_t n) {
+	if (n > maxBlasSize) throw Common::Exception() << "size " << n << " exceeds the BLAS integer range of " << maxBlasSize << ".  define SOLVER_BLAS_ILP64 and link a 64-bit-integer BLAS.";
+	return (BlasInt)n;
+}
+
+//LAPACK info < 0 is an invalid argument, which the wrappers below never mean to pass
+static void checkInfo(const char* routine, BlasInt info) {
+	if (info < 0) throw Common::Exception() << routine << ": invalid argument " << -info;
+}
+
+//dot and axpy are split into chunks of maxBlasSize, so any size works without ILP64
+
+float Blas<float>::dot(size_t n, const float* x, const float* y) {
+	float sum = 0;
+	for (size_t i = 0; i < n; i += maxBlasSize) {
+		BlasInt n_ = (BlasInt)std::min(n - i, maxBlasSize);
+		sum += sdot_(&n_, x + i, &one, y + i, &one);
+	}
+	return sum;
+}
+
+double Blas<double>::dot(size_t n, const double* x, const double* y) {
+	double sum = 0;
+	for (size_t i = 0; i < n; i += maxBlasSize) {
+		BlasInt n_ = (BlasInt)std::min(n - i, maxBlasSize);
+		sum += ddot_(&n_, x + i, &one, y + i, &one);
+	}
+	return sum;
+}
+
+void Blas<float>::axpy(size_t n, float alpha, const float* x, float* y) {
+	for (size_t i = 0; i < n; i += maxBlasSize) {
+		BlasInt n_ = (BlasInt)std::min(n - i, maxBlasSize);
+		saxpy_(&n_, &alpha, x + i, &one, y + i, &one);
+	}
+}
+
+void Blas<double>::axpy(size_t n, double alpha, const double* x, double* y) {
+	for (size_t i = 0; i < n; i += maxBlasSize) {
+		BlasInt n_ = (BlasInt)std::min(n - i, maxBlasSize);
+		daxpy_(&n_, &alpha, x + i, &one, y + i, &one);
+	}
+}
+
+void Blas<float>::gemv(size_t m, size_t n, float alpha, const float* a, size_t lda, const float* x, float beta, float* y) {
+	BlasInt m_ = toBlasInt(m), n_ = toBlasInt(n), lda_ = toBlasInt(lda);
+	sgemv_("N", &m_, &n_, &alpha, a, &lda_, x, &one, &beta, y, &one, 1);
+}
+
+void Blas<double>::gemv(size_t m, size_t n, double alpha, const double* a, size_t lda, const double* x, double beta, double* y) {
+	BlasInt m_ = toBlasInt(m), n_ = toBlasInt(n), lda_ = toBlasInt(lda);
+	dgemv_("N", &m_, &n_, &alpha, a, &lda_, x, &one, &beta, y, &one, 1);
+}
+
+void Blas<float>::trsvUpper(size_t n, const float* a, size_t lda, float* x) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda);
+	strsv_("U", "N", "N", &n_, a, &lda_, x, &one, 1, 1, 1);
+}
+
+void Blas<double>::trsvUpper(size_t n, const double* a, size_t lda, double* x) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda);
+	dtrsv_("U", "N", "N", &n_, a, &lda_, x, &one, 1, 1, 1);
+}
+
+//workspace sizes are queried with lwork = -1 first
+BlasInt Blas<float>::geqrf(size_t m, size_t n, float* a, size_t lda, float* tau) {
+	BlasInt m_ = toBlasInt(m), n_ = toBlasInt(n), lda_ = toBlasInt(lda), lwork = -1, info = 0;
+	float query = 0;
+	sgeqrf_(&m_, &n_, a, &lda_, tau, &query, &lwork, &info);
+	checkInfo("sgeqrf", info);
+	lwork = (BlasInt)query > 1 ? (BlasInt)query : 1;
+	std::vector<float> work(lwork);
+	sgeqrf_(&m_, &n_, a, &lda_, tau, work.data(), &lwork, &info);
+	checkInfo("sgeqrf", info);
+	return info;
+}
+
+BlasInt Blas<double>::geqrf(size_t m, size_t n, double* a, size_t lda, double* tau) {
+	BlasInt m_ = toBlasInt(m), n_ = toBlasInt(n), lda_ = toBlasInt(lda), lwork = -1, info = 0;
+	double query = 0;
+	dgeqrf_(&m_, &n_, a, &lda_, tau, &query, &lwork, &info);
+	checkInfo("dgeqrf", info);
+	lwork = (BlasInt)query > 1 ? (BlasInt)query : 1;
+	std::vector<double> work(lwork);
+	dgeqrf_(&m_, &n_, a, &lda_, tau, work.data(), &lwork, &info);
+	checkInfo("dgeqrf", info);
+	return info;
+}
+
+void Blas<float>::ormqrT(size_t m, size_t nrhs, size_t k, const float* a, size_t lda, const float* tau, float* c, size_t ldc) {
+	BlasInt m_ = toBlasInt(m), nrhs_ = toBlasInt(nrhs), k_ = toBlasInt(k), lda_ = toBlasInt(lda), ldc_ = toBlasInt(ldc), lwork = -1, info = 0;
+	float query = 0;
+	sormqr_("L", "T", &m_, &nrhs_, &k_, a, &lda_, tau, c, &ldc_, &query, &lwork, &info, 1, 1);
+	checkInfo("sormqr", info);
+	lwork = (BlasInt)query > 1 ? (BlasInt)query : 1;
+	std::vector<float> work(lwork);
+	sormqr_("L", "T", &m_, &nrhs_, &k_, a, &lda_, tau, c, &ldc_, work.data(), &lwork, &info, 1, 1);
+	checkInfo("sormqr", info);
+}
+
+void Blas<double>::ormqrT(size_t m, size_t nrhs, size_t k, const double* a, size_t lda, const double* tau, double* c, size_t ldc) {
+	BlasInt m_ = toBlasInt(m), nrhs_ = toBlasInt(nrhs), k_ = toBlasInt(k), lda_ = toBlasInt(lda), ldc_ = toBlasInt(ldc), lwork = -1, info = 0;
+	double query = 0;
+	dormqr_("L", "T", &m_, &nrhs_, &k_, a, &lda_, tau, c, &ldc_, &query, &lwork, &info, 1, 1);
+	checkInfo("dormqr", info);
+	lwork = (BlasInt)query > 1 ? (BlasInt)query : 1;
+	std::vector<double> work(lwork);
+	dormqr_("L", "T", &m_, &nrhs_, &k_, a, &lda_, tau, c, &ldc_, work.data(), &lwork, &info, 1, 1);
+	checkInfo("dormqr", info);
+}
+
+BlasInt Blas<float>::getrf(size_t n, float* a, size_t lda, BlasInt* ipiv) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda), info = 0;
+	sgetrf_(&n_, &n_, a, &lda_, ipiv, &info);
+	checkInfo("sgetrf", info);
+	return info;
+}
+
+BlasInt Blas<double>::getrf(size_t n, double* a, size_t lda, BlasInt* ipiv) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda), info = 0;
+	dgetrf_(&n_, &n_, a, &lda_, ipiv, &info);
+	checkInfo("dgetrf", info);
+	return info;
+}
+
+void Blas<float>::getrs(size_t n, size_t nrhs, const float* a, size_t lda, const BlasInt* ipiv, float* b, size_t ldb) {
+	BlasInt n_ = toBlasInt(n), nrhs_ = toBlasInt(nrhs), lda_ = toBlasInt(lda), ldb_ = toBlasInt(ldb), info = 0;
+	sgetrs_("N", &n_, &nrhs_, a, &lda_, ipiv, b, &ldb_, &info, 1);
+	checkInfo("sgetrs", info);
+}
+
+void Blas<double>::getrs(size_t n, size_t nrhs, const double* a, size_t lda, const BlasInt* ipiv, double* b, size_t ldb) {
+	BlasInt n_ = toBlasInt(n), nrhs_ = toBlasInt(nrhs), lda_ = toBlasInt(lda), ldb_ = toBlasInt(ldb), info = 0;
+	dgetrs_("N", &n_, &nrhs_, a, &lda_, ipiv, b, &ldb_, &info, 1);
+	checkInfo("dgetrs", info);
+}
+
+BlasInt Blas<float>::potrf(size_t n, float* a, size_t lda) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda), info = 0;
+	spotrf_("L", &n_, a, &lda_, &info, 1);
+	checkInfo("spotrf", info);
+	return info;
+}
+
+BlasInt Blas<double>::potrf(size_t n, double* a, size_t lda) {
+	BlasInt n_ = toBlasInt(n), lda_ = toBlasInt(lda), info = 0;
+	dpotrf_("L", &n_, a, &lda_, &info, 1);
+	checkInfo("dpotrf", info);
+	return info;
+}
+
+void Blas<float>::potrs(size_t n, size_t nrhs, const float* a, size_t lda, float* b, size_t ldb) {
+	BlasInt n_ = toBlasInt(n), nrhs_ = toBlasInt(nrhs), lda_ = toBlasInt(lda), ldb_ = toBlasInt(ldb), info = 0;
+	spotrs_("L", &n_, &nrhs_, a, &lda_, b, &ldb_, &info, 1);
+	checkInfo("spotrs", info);
+}
+
+void Blas<double>::potrs(size_t n, size_t nrhs, const double* a, size_t lda, double* b, size_t ldb) {
+	BlasInt n_ = toBlasInt(n), nrhs_ = toBlasInt(nrhs), lda_ = toBlasInt(lda), ldb_ = toBlasInt(ldb), info = 0;
+	dpotrs_("L", &n_, &nrhs_, a, &lda_, b, &ldb_, &info, 1);
+	checkInfo("dpotrs", info);
+}
+
+}
+
+#endif
@@ -0,0 +1,8 @@
+#include "Solver/CSR.h"
+
+namespace Solver {
+
+template struct CSR<float>;
+template struct CSR<double>;
+
+}
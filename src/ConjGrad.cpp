@@ -1,8 +1,18 @@
 #include "Solver/ConjGrad.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
 
 namespace Solver {
 
 template struct ConjGrad<float>;
 template struct ConjGrad<double>;
 
+template struct ConjGrad<DoubleDouble>;
+template struct ConjGrad<std::complex<float>>;
+template struct ConjGrad<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct ConjGrad<__float128>;
+#endif
+
 }
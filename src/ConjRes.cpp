@@ -1,8 +1,14 @@
 #include "Solver/ConjRes.h"
+#include "Solver/DoubleDouble.h"
 
 namespace Solver {
 
 template struct ConjRes<float>;
 template struct ConjRes<double>;
 
+template struct ConjRes<DoubleDouble>;
+#if defined(SOLVER_HAS_FLOAT128)
+template struct ConjRes<__float128>;
+#endif
+
 }
@@ -1,4 +1,6 @@
 #include "Solver/DenseInverse.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
 
 namespace Solver {
 
@@ -7,5 +9,29 @@ template struct DenseInverse<double>;
 
 template struct HouseholderQR<float>;
 template struct HouseholderQR<double>;
+template struct LU<float>;
+template struct LU<double>;
+template struct Cholesky<float>;
+template struct Cholesky<double>;
+
+template struct DenseInverse<DoubleDouble>;
+template struct HouseholderQR<DoubleDouble>;
+template struct LU<DoubleDouble>;
+template struct Cholesky<DoubleDouble>;
+template struct DenseInverse<std::complex<float>>;
+template struct HouseholderQR<std::complex<float>>;
+template struct LU<std::complex<float>>;
+template struct Cholesky<std::complex<float>>;
+template struct DenseInverse<std::complex<double>>;
+template struct HouseholderQR<std::complex<double>>;
+template struct LU<std::complex<double>>;
+template struct Cholesky<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct DenseInverse<__float128>;
+template struct HouseholderQR<__float128>;
+template struct LU<__float128>;
+template struct Cholesky<__float128>;
+#endif
 
 }
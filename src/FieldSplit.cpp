@@ -0,0 +1,8 @@
+#include "Solver/FieldSplit.h"
+
+namespace Solver {
+
+template struct FieldSplit<float>;
+template struct FieldSplit<double>;
+
+}
@@ -1,8 +1,18 @@
 #include "Solver/GMRES.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
 
 namespace Solver {
 
 template struct GMRES<float>;
 template struct GMRES<double>;
 
+template struct GMRES<DoubleDouble>;
+template struct GMRES<std::complex<float>>;
+template struct GMRES<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct GMRES<__float128>;
+#endif
+
 }
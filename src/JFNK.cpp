@@ -1,8 +1,14 @@
 #include "Solver/JFNK.h"
+#include "Solver/DoubleDouble.h"
 
 namespace Solver {
 
 template struct JFNK<float>;
 template struct JFNK<double>;
 
+template struct JFNK<DoubleDouble>;
+#if defined(SOLVER_HAS_FLOAT128)
+template struct JFNK<__float128>;
+#endif
+
 }
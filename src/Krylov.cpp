@@ -1,8 +1,18 @@
 #include "Solver/Krylov.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
 
 namespace Solver {
 
 template struct Krylov<float>;
 template struct Krylov<double>;
 
+template struct Krylov<DoubleDouble>;
+template struct Krylov<std::complex<float>>;
+template struct Krylov<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct Krylov<__float128>;
+#endif
+
 }
@@ -0,0 +1,18 @@
+#include "Solver/MultiShiftConjGrad.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct MultiShiftConjGrad<float>;
+template struct MultiShiftConjGrad<double>;
+
+template struct MultiShiftConjGrad<DoubleDouble>;
+template struct MultiShiftConjGrad<std::complex<float>>;
+template struct MultiShiftConjGrad<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct MultiShiftConjGrad<__float128>;
+#endif
+
+}
@@ -0,0 +1,18 @@
+#include "Solver/MultiShiftGMRES.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct MultiShiftGMRES<float>;
+template struct MultiShiftGMRES<double>;
+
+template struct MultiShiftGMRES<DoubleDouble>;
+template struct MultiShiftGMRES<std::complex<float>>;
+template struct MultiShiftGMRES<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct MultiShiftGMRES<__float128>;
+#endif
+
+}
@@ -0,0 +1,8 @@
+#include "Solver/MulticolorGaussSeidel.h"
+
+namespace Solver {
+
+template struct MulticolorGaussSeidel<float>;
+template struct MulticolorGaussSeidel<double>;
+
+}
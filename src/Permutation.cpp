@@ -0,0 +1,8 @@
+#include "Solver/Permutation.h"
+
+namespace Solver {
+
+template struct Permutation<float>;
+template struct Permutation<double>;
+
+}
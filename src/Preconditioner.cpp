@@ -0,0 +1,18 @@
+#include "Solver/Preconditioner.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct Preconditioner<float>;
+template struct Preconditioner<double>;
+
+template struct Preconditioner<DoubleDouble>;
+template struct Preconditioner<std::complex<float>>;
+template struct Preconditioner<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct Preconditioner<__float128>;
+#endif
+
+}
@@ -0,0 +1,18 @@
+#include "Solver/RandomizedLeastSquares.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct RandomizedLeastSquares<float>;
+template struct RandomizedLeastSquares<double>;
+
+template struct RandomizedLeastSquares<DoubleDouble>;
+template struct RandomizedLeastSquares<std::complex<float>>;
+template struct RandomizedLeastSquares<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct RandomizedLeastSquares<__float128>;
+#endif
+
+}
@@ -0,0 +1,18 @@
+#include "Solver/RandomizedSVD.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct RandomizedSVD<float>;
+template struct RandomizedSVD<double>;
+
+template struct RandomizedSVD<DoubleDouble>;
+template struct RandomizedSVD<std::complex<float>>;
+template struct RandomizedSVD<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct RandomizedSVD<__float128>;
+#endif
+
+}
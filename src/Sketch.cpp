@@ -0,0 +1,24 @@
+#include "Solver/Sketch.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct Sketch<float>;
+template struct Sketch<double>;
+template struct SparseSignSketch<float>;
+template struct SparseSignSketch<double>;
+
+template struct Sketch<DoubleDouble>;
+template struct Sketch<std::complex<float>>;
+template struct Sketch<std::complex<double>>;
+template struct SparseSignSketch<DoubleDouble>;
+template struct SparseSignSketch<std::complex<float>>;
+template struct SparseSignSketch<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct Sketch<__float128>;
+template struct SparseSignSketch<__float128>;
+#endif
+
+}
@@ -0,0 +1,18 @@
+#include "Solver/SketchedGMRES.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct SketchedGMRES<float>;
+template struct SketchedGMRES<double>;
+
+template struct SketchedGMRES<DoubleDouble>;
+template struct SketchedGMRES<std::complex<float>>;
+template struct SketchedGMRES<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct SketchedGMRES<__float128>;
+#endif
+
+}
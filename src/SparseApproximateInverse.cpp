@@ -0,0 +1,11 @@
+#include "Solver/SparseApproximateInverse.h"
+
+namespace Solver {
+
+template struct FSAI<float>;
+template struct FSAI<double>;
+
+template struct SPAI<float>;
+template struct SPAI<double>;
+
+}
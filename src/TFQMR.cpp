@@ -0,0 +1,14 @@
+#include "Solver/TFQMR.h"
+#include "Solver/DoubleDouble.h"
+
+namespace Solver {
+
+template struct TFQMR<float>;
+template struct TFQMR<double>;
+
+template struct TFQMR<DoubleDouble>;
+#if defined(SOLVER_HAS_FLOAT128)
+template struct TFQMR<__float128>;
+#endif
+
+}
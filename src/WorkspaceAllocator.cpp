@@ -0,0 +1,18 @@
+#include "Solver/WorkspaceAllocator.h"
+#include "Solver/DoubleDouble.h"
+#include <complex>
+
+namespace Solver {
+
+template struct WorkspaceAllocator<float>;
+template struct WorkspaceAllocator<double>;
+
+template struct WorkspaceAllocator<DoubleDouble>;
+template struct WorkspaceAllocator<std::complex<float>>;
+template struct WorkspaceAllocator<std::complex<double>>;
+
+#if defined(SOLVER_HAS_FLOAT128)
+template struct WorkspaceAllocator<__float128>;
+#endif
+
+}
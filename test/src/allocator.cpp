@@ -0,0 +1,156 @@
+#include "Solver/Allocator.h"
+#include "Solver/WorkspaceAllocator.h"
+#include "Solver/Parallel.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+/*
+first-touch zeroing across the thread pool,
+and each range of a Parallel kernel landing on the same pool worker from call to call, which is what first-touch placement relies on
+*/
+static void test_firstTouch() {
+	size_t numThreads = 4;
+	size_t n = 1 << 20;
+	auto allocator = std::make_shared<Solver::Allocator<double>>();
+	allocator->numThreads = numThreads;
+	allocator->parallelMinBytes = 0;
+	double* p = allocator->allocate(n, "firstTouch");
+	bool zeroed = true;
+	for (size_t i = 0; i < n; ++i) {
+		if (p[i] != 0) zeroed = false;
+	}
+	allocator->deallocate(p, n);
+
+	std::vector<std::thread::id> first(numThreads), second(numThreads);
+	Solver::Parallel::forRange(numThreads, numThreads, [&](size_t begin, size_t) {
+		first[begin] = std::this_thread::get_id();
+	});
+	Solver::Parallel::forRange(numThreads, numThreads, [&](size_t begin, size_t) {
+		second[begin] = std::this_thread::get_id();
+	});
+	bool sameThreads = first == second;
+	bool distinctThreads = true;
+	for (size_t i = 0; i < numThreads; ++i) {
+		for (size_t j = i+1; j < numThreads; ++j) {
+			if (first[i] == first[j]) distinctThreads = false;
+		}
+	}
+
+	//a kernel called from inside a range runs serially rather than waiting on the busy pool
+	int nestedRanges = 0;
+	Solver::Parallel::forRange(1, 1, [&](size_t, size_t) {
+		Solver::Parallel::forRange(100, numThreads, [&](size_t, size_t) { ++nestedRanges; });
+	});
+	Solver::Parallel::forRange(2, 2, [&](size_t begin, size_t) {
+		if (begin == 0) Solver::Parallel::forRange(100, numThreads, [&](size_t, size_t) { ++nestedRanges; });
+	});
+
+	printf("allocator first touch: zeroed %s, ranges on the same threads across calls %s, on distinct threads %s, nested calls ran %d ranges\n",
+		zeroed ? "yes" : "no", sameThreads ? "yes" : "no", distinctThreads ? "yes" : "no", nestedRanges);
+}
+
+/*
+an exception from the calling thread's range or from a worker's reaches the caller once every range is done,
+and the pool keeps running later calls in parallel
+*/
+static void test_poolExceptions() {
+	size_t numThreads = 4;
+	int caught = 0;
+	for (size_t throwingRange : {numThreads - 1, (size_t)0}) {
+		std::atomic<int> finished(0);
+		try {
+			Solver::Parallel::forRange(numThreads, numThreads, [&](size_t begin, size_t) {
+				if (begin == throwingRange) throw std::runtime_error("range failed");
+				++finished;
+			});
+		} catch (const std::runtime_error&) {
+			if (finished == (int)numThreads - 1) ++caught;
+		}
+	}
+
+	std::vector<std::thread::id> ids(numThreads);
+	Solver::Parallel::forRange(numThreads, numThreads, [&](size_t begin, size_t) {
+		ids[begin] = std::this_thread::get_id();
+	});
+	bool parallelAfter = ids[0] != ids[numThreads - 1];
+
+	printf("pool exceptions: %d of 2 rethrown after every range finished, later calls parallel %s\n",
+		caught, parallelAfter ? "yes" : "no");
+}
+
+/*
+bookkeeping only when trackAllocations is set, reportCallback either way,
+and huge pages reported as transparent only when the kernel has THP enabled
+*/
+static void test_tracking() {
+	auto allocator = std::make_shared<Solver::Allocator<double>>();
+	int reports = 0;
+	allocator->reportCallback = [&](const Solver::Allocator<double>::Allocation&) { ++reports; };
+	double* untracked = allocator->allocate(100, "untracked");
+	size_t liveUntracked = allocator->getAllocations().size();
+	allocator->trackAllocations = true;
+	double* tracked = allocator->allocate(100, "tracked");
+	auto live = allocator->getAllocations();
+	allocator->deallocate(untracked, 100);
+	allocator->deallocate(tracked, 100);
+	printf("allocator tracking: live untracked %d, live tracked %d named %s, after deallocating %d, reports %d\n",
+		(int)liveUntracked, (int)live.size(), live.size() == 1 ? live[0].name.c_str() : "-",
+		(int)allocator->getAllocations().size(), reports);
+
+	//which pages this machine gives is up to its configuration, so only check the report against it
+	size_t n = 1 << 20;
+	allocator->hugePages = Solver::Allocator<double>::PAGES_HUGETLB_1GB;
+	allocator->hugePagesMinBytes = 0;
+	double* p = allocator->allocate(n, "huge");
+	auto pages = allocator->getAllocations()[0].pages;
+	bool zeroed = true;
+	for (size_t i = 0; i < n; ++i) {
+		if (p[i] != 0) zeroed = false;
+	}
+	allocator->deallocate(p, n);
+	char thp[256] = {};
+	FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+	if (file) {
+		size_t length = fread(thp, 1, sizeof(thp) - 1, file);
+		thp[length] = 0;
+		fclose(file);
+	}
+	bool thpEnabled = strstr(thp, "[always]") || strstr(thp, "[madvise]");
+	bool consistent = pages != Solver::Allocator<double>::PAGES_TRANSPARENT_HUGE || thpEnabled;
+	printf("allocator huge pages: zeroed %s, report consistent with the kernel's THP setting %s, live after deallocating %d\n",
+		zeroed ? "yes" : "no", consistent ? "yes" : "no", (int)allocator->getAllocations().size());
+}
+
+//out-of-order deallocations leave holes that are reused and merged, so nothing leaks until reset()
+static void test_workspaceHoles() {
+	using WorkspaceAllocator = Solver::WorkspaceAllocator<double>;
+	std::vector<double> workspace(WorkspaceAllocator::getAllocationSize(100) * 3);
+	WorkspaceAllocator allocator(workspace.data(), workspace.size());
+	double* a = allocator.allocate(100, "a");
+	double* b = allocator.allocate(100, "b");
+	double* c = allocator.allocate(100, "c");
+	size_t full = allocator.getUsed();
+	allocator.deallocate(b, 100);
+	double* d = allocator.allocate(50, "d");
+	bool reusedHole = d == b;
+	allocator.deallocate(a, 100);
+	allocator.deallocate(d, 50);
+	size_t usedBeforeLast = allocator.getUsed();
+	allocator.deallocate(c, 100);
+	size_t usedAfterLast = allocator.getUsed();
+	//the merged hole of a, b and d is returned along with c, so the whole workspace is free again
+	double* e = allocator.allocate(300, "e");
+	printf("workspace holes: full %d, hole reused %s, used before the last deallocation %d, after %d, reallocated whole %s\n",
+		(int)full, reusedHole ? "yes" : "no", (int)usedBeforeLast, (int)usedAfterLast, e == workspace.data() ? "yes" : "no");
+}
+
+void test_allocator() {
+	test_firstTouch();
+	test_poolExceptions();
+	test_tracking();
+	test_workspaceHoles();
+}
@@ -0,0 +1,82 @@
+#include "Solver/ConjGrad.h"
+#include "Solver/GMRES.h"
+#include "Solver/DenseInverse.h"
+#include <complex>
+#include <vector>
+#include <random>
+#include <stdio.h>
+
+using complex = std::complex<double>;
+
+//tridiagonal y = A x with constant bands
+static std::function<void(complex*, const complex*)> tridiagonal(int n, complex lower, complex diag, complex upper) {
+	return [=](complex* y, const complex* x) {
+		for (int i = 0; i < n; ++i) {
+			complex sum = diag * x[i];
+			if (i > 0) sum += lower * x[i-1];
+			if (i < n-1) sum += upper * x[i+1];
+			y[i] = sum;
+		}
+	};
+}
+
+static double residual(int n, std::function<void(complex*, const complex*)> A, const complex* x, const complex* b) {
+	std::vector<complex> Ax(n);
+	A(Ax.data(), x);
+	double sum = 0;
+	for (int i = 0; i < n; ++i) {
+		sum += std::norm(b[i] - Ax[i]);
+	}
+	return sqrt(sum);
+}
+
+void test_complex() {
+	int n = 200;
+	std::vector<complex> b(n);
+	for (int i = 0; i < n; ++i) {
+		b[i] = complex(cos(.1 * i), sin(.05 * i));
+	}
+
+	//Hermitian positive-definite: 1D magnetic Laplacian, hopping terms carry a phase
+	{
+		complex phase = std::polar(1., .3);
+		auto A = tridiagonal(n, -std::conj(phase), 2.5, -phase);
+		std::vector<complex> x(n);
+		Solver::ConjGrad<complex> cg(n, x.data(), b.data(), A, 1e-10, 10 * n);
+		cg.solve();
+		printf("magnetic Laplacian: cg iter %d residual %e\n", cg.getIter(), residual(n, A, x.data(), b.data()));
+	}
+
+	//complex-symmetric, indefinite: damped 1D Helmholtz -u'' - k^2 u + i sigma u
+	{
+		double kh = .5;
+		auto A = tridiagonal(n, -1., complex(2. - kh * kh, .2), -1.);
+		std::vector<complex> x(n);
+		Solver::GMRES<complex> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 50);
+		gmres.solve();
+		printf("damped Helmholtz: gmres iter %d residual %e\n", gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+
+	//dense non-Hermitian
+	{
+		int m = 20;
+		std::mt19937 rng(1);
+		std::normal_distribution<double> normal;
+		std::vector<complex> a(m * m);
+		for (auto& aij : a) {
+			aij = complex(normal(rng), normal(rng));
+		}
+		auto A = [&](complex* y, const complex* x) {
+			for (int i = 0; i < m; ++i) {
+				complex sum = 0;
+				for (int j = 0; j < m; ++j) {
+					sum += a[i + m * j] * x[j];
+				}
+				y[i] = sum;
+			}
+		};
+		std::vector<complex> x(m);
+		Solver::HouseholderQR<complex>().solveLinear(m, x.data(), a.data(), b.data());
+		printf("dense QR: residual %e\n", residual(m, A, x.data(), b.data()));
+	}
+}
@@ -0,0 +1,103 @@
+#include "Solver/Expr.h"
+#include <algorithm>
+#include <complex>
+#include <exception>
+#include <vector>
+#include <stdio.h>
+#include <math.h>
+
+/*
+fused statements against the plain loops they replace:
+bit-identical with one thread, and with several the updates still are while the dot product only differs by summation order
+*/
+static void test_fused(size_t numThreads) {
+	size_t n = 1001;
+	std::vector<double> x(n), r(n), p(n), Ap(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = sin((double)i);
+		r[i] = cos((double)i);
+		p[i] = 1. / (1. + i);
+		Ap[i] = (double)(i % 7) - 3.;
+	}
+	std::vector<double> x0 = x, r0 = r;
+	double alpha = .37;
+
+	double rr0 = 0;
+	for (size_t i = 0; i < n; ++i) {
+		x0[i] += p[i] * alpha;
+		r0[i] -= Ap[i] * alpha;
+		rr0 += r0[i] * r0[i];
+	}
+
+	auto xv = Solver::view(n, x.data());
+	auto rv = Solver::view(n, r.data());
+	auto rr = Solver::dot(rv, rv);
+	Solver::evalParallel(numThreads, xv += Solver::view(n, p.data()) * alpha, rv -= Solver::view(n, Ap.data()) * alpha, rr);
+
+	bool updatesMatch = x == x0 && r == r0;
+	double rrError = fabs((double)rr - rr0) / rr0;
+	printf("expr fused, %d threads: updates match %s, dot %s\n",
+		(int)numThreads, updatesMatch ? "yes" : "no",
+		rrError == 0 ? "exact" : (rrError < 1e-14 ? "within 1e-14" : "wrong"));
+}
+
+//mismatched sizes throw before anything is written, from a single statement or from eval()
+static void test_sizeMismatch() {
+	size_t n = 10;
+	std::vector<double> x(n, 1.), r(n, 2.), shortP(n-1, 3.);
+	auto xv = Solver::view(n, x.data());
+	auto rv = Solver::view(n, r.data());
+	auto shortPv = Solver::view(n-1, shortP.data());
+
+	int thrown = 0;
+	try {
+		xv += shortPv;
+	} catch (const std::exception&) {
+		++thrown;
+	}
+	try {
+		xv += rv + shortPv;
+	} catch (const std::exception&) {
+		++thrown;
+	}
+	try {
+		double d = Solver::dot(xv, shortPv);
+		(void)d;
+	} catch (const std::exception&) {
+		++thrown;
+	}
+	try {
+		Solver::eval(xv += rv, Solver::view(n-1, r.data()) = shortPv);
+	} catch (const std::exception&) {
+		++thrown;
+	}
+
+	bool untouched = std::all_of(x.begin(), x.end(), [](double xi) { return xi == 1.; })
+		&& std::all_of(r.begin(), r.end(), [](double ri) { return ri == 2.; });
+	printf("expr size mismatch: %d of 4 thrown, vectors untouched %s\n", thrown, untouched ? "yes" : "no");
+}
+
+//a dot of two views on its own runs Vector's kernel, so with one thread it matches Vector::dot exactly
+static void test_loneDot() {
+	size_t n = 1001;
+	std::vector<double> a(n), b(n);
+	std::vector<std::complex<double>> ca(n), cb(n);
+	for (size_t i = 0; i < n; ++i) {
+		a[i] = sin((double)i);
+		b[i] = cos((double)i);
+		ca[i] = {a[i], b[i]};
+		cb[i] = {1. / (1. + i), a[i]};
+	}
+	double d = Solver::dot(Solver::view(n, a.data()), Solver::view(n, b.data()));
+	std::complex<double> cd = Solver::dot(Solver::view(n, ca.data()), Solver::view(n, cb.data()));
+	printf("expr lone dot matches Vector::dot: real %s, complex %s\n",
+		d == Solver::Vector<double>::dot(n, a.data(), b.data()) ? "yes" : "no",
+		cd == Solver::Vector<std::complex<double>>::dot(n, ca.data(), cb.data()) ? "yes" : "no");
+}
+
+void test_expr() {
+	test_fused(1);
+	test_fused(4);
+	test_sizeMismatch();
+	test_loneDot();
+}
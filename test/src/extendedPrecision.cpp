@@ -0,0 +1,63 @@
+#include "Solver/DoubleDouble.h"
+#include "Solver/DenseInverse.h"
+#include "Solver/GMRES.h"
+#include <vector>
+#include <stdio.h>
+
+/*
+Hilbert matrix, condition number ~1e16 at n = 12
+b = H * ones, formed in the working precision, so the exact solution is ones up to b's rounding
+returns max |x - 1| for QR and for GMRES
+*/
+template<typename real>
+static void solveHilbert(const char* name, size_t n) {
+	std::vector<real> a(n * n);
+	for (int j = 0; j < (int)n; ++j) {
+		for (int i = 0; i < (int)n; ++i) {
+			a[i + n * j] = real(1) / real(i + j + 1);
+		}
+	}
+	std::vector<real> b(n);
+	for (int i = 0; i < (int)n; ++i) {
+		real sum = 0;
+		for (int j = 0; j < (int)n; ++j) {
+			sum += a[i + n * j];
+		}
+		b[i] = sum;
+	}
+	auto maxError = [&](const std::vector<real>& x) -> double {
+		double err = 0;
+		for (int i = 0; i < (int)n; ++i) {
+			err = std::max(err, fabs((double)(x[i] - real(1))));
+		}
+		return err;
+	};
+
+	std::vector<real> x(n);
+	Solver::HouseholderQR<real>().solveLinear(n, x.data(), a.data(), b.data());
+	double qrError = maxError(x);
+
+	std::fill(x.begin(), x.end(), real(0));
+	Solver::GMRES<real> gmres(n, x.data(), b.data(), [&](real* y, const real* x) {
+		for (int i = 0; i < (int)n; ++i) {
+			real sum = 0;
+			for (int j = 0; j < (int)n; ++j) {
+				sum += a[i + n * j] * x[j];
+			}
+			y[i] = sum;
+		}
+	}, 1e-30, 2 * n, n);
+	gmres.solve();
+	double gmresError = maxError(x);
+
+	printf("%s: QR max error %e, GMRES max error %e\n", name, qrError, gmresError);
+}
+
+void test_extendedPrecision() {
+	size_t n = 12;
+	solveHilbert<double>("double", n);
+	solveHilbert<Solver::DoubleDouble>("double-double", n);
+#if defined(SOLVER_HAS_FLOAT128)
+	solveHilbert<__float128>("__float128", n);
+#endif
+}
@@ -0,0 +1,76 @@
+#include "Solver/MultiShiftConjGrad.h"
+#include "Solver/MultiShiftGMRES.h"
+#include "Solver/ConjGrad.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+//tridiagonal y = A x with constant bands
+static std::function<void(double*, const double*)> tridiagonal(int n, double lower, double diag, double upper) {
+	return [=](double* y, const double* x) {
+		for (int i = 0; i < n; ++i) {
+			double sum = diag * x[i];
+			if (i > 0) sum += lower * x[i-1];
+			if (i < n-1) sum += upper * x[i+1];
+			y[i] = sum;
+		}
+	};
+}
+
+//|b - (A + shift I) x|
+static double shiftedResidual(int n, std::function<void(double*, const double*)> A, double shift, const double* x, const double* b) {
+	std::vector<double> Ax(n);
+	A(Ax.data(), x);
+	double sum = 0;
+	for (int i = 0; i < n; ++i) {
+		double ri = b[i] - Ax[i] - shift * x[i];
+		sum += ri * ri;
+	}
+	return sqrt(sum);
+}
+
+void test_multiShift() {
+	int n = 400;
+	std::vector<double> b(n);
+	for (int i = 0; i < n; ++i) {
+		b[i] = cos(.1 * i);
+	}
+	std::vector<double> shifts = {0., .001, .01, .1, 1.};
+	int numShifts = (int)shifts.size();
+
+	//1D Laplacian, shifted: one CG iteration per operator application for all shifts
+	{
+		auto A = tridiagonal(n, -1., 2., -1.);
+		std::vector<double> x(n * numShifts);
+		Solver::MultiShiftConjGrad<double> cg(n, numShifts, shifts.data(), x.data(), b.data(), A, 1e-10, 10 * n);
+		cg.solve();
+		printf("multi-shift cg: iter %d\n", cg.getIter());
+
+		int separateIter = 0;
+		for (int k = 0; k < numShifts; ++k) {
+			std::vector<double> xk(n);
+			double shift = shifts[k];
+			Solver::ConjGrad<double> single(n, xk.data(), b.data(), [&](double* y, const double* x) {
+				A(y, x);
+				for (int i = 0; i < n; ++i) y[i] += shift * x[i];
+			}, 1e-10, 10 * n);
+			single.solve();
+			separateIter += single.getIter();
+			printf("shift %g: residual %e, separate cg iter %d\n", shift, shiftedResidual(n, A, shift, x.data() + n * k, b.data()), single.getIter());
+		}
+		printf("separate cg total iter %d\n", separateIter);
+	}
+
+	//1D convection-diffusion, nonsymmetric: restarted GMRES with collinear residuals
+	{
+		auto A = tridiagonal(n, -1.3, 2., -.7);
+		std::vector<double> x(n * numShifts);
+		Solver::MultiShiftGMRES<double> gmres(n, numShifts, shifts.data(), x.data(), b.data(), A, 1e-10, 10 * n, 40);
+		gmres.solve();
+		printf("multi-shift gmres: iter %d\n", gmres.getIter());
+		for (int k = 0; k < numShifts; ++k) {
+			printf("shift %g: residual %e, estimated %e\n", shifts[k], shiftedResidual(n, A, shifts[k], x.data() + n * k, b.data()), (double)gmres.getShiftResidual(k));
+		}
+	}
+}
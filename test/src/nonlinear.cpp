@@ -0,0 +1,341 @@
+#include "Solver/JFNK.h"
+#include "Solver/GMRES.h"
+#include "Solver/ConjGrad.h"
+#include "Solver/Preconditioner.h"
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+
+//1D Bratu problem -u'' = lambda exp(u) on (0,1), u(0) = u(1) = 0, on n interior points
+static Solver::JFNK<double>::Func bratu(size_t n, double lambda, int& numF) {
+	return [=, &numF](double* y, const double* u) {
+		++numF;
+		double h = 1. / (double)(n + 1);
+		for (size_t i = 0; i < n; ++i) {
+			double ul = i > 0 ? u[i-1] : 0.;
+			double ur = i < n-1 ? u[i+1] : 0.;
+			y[i] = (2. * u[i] - ul - ur) / (h * h) - lambda * exp(u[i]);
+		}
+	};
+}
+
+/*
+physics-based preconditioner: the exact tridiagonal Jacobian of the Bratu problem at x,
+factored with the Thomas algorithm in setup() and back-substituted in apply()
+*/
+struct BratuPreconditioner : public Solver::Preconditioner<double> {
+	size_t n;
+	double lambda;
+	std::vector<double> diag, upperFactored;
+	int numSetup = 0;
+	int numApply = 0;
+
+	BratuPreconditioner(size_t n_, double lambda_) : n(n_), lambda(lambda_), diag(n_), upperFactored(n_) {}
+
+	virtual void setup(const double* x, const double*) {
+		++numSetup;
+		double h = 1. / (double)(n + 1);
+		double offDiag = -1. / (h * h);
+		for (size_t i = 0; i < n; ++i) {
+			double d = 2. / (h * h) - lambda * exp(x[i]);
+			if (i > 0) d -= offDiag * upperFactored[i-1];
+			diag[i] = d;
+			upperFactored[i] = offDiag / d;
+		}
+	}
+
+	virtual void apply(double* y, const double* r) {
+		++numApply;
+		double h = 1. / (double)(n + 1);
+		double offDiag = -1. / (h * h);
+		for (size_t i = 0; i < n; ++i) {
+			y[i] = (r[i] - (i > 0 ? offDiag * y[i-1] : 0.)) / diag[i];
+		}
+		for (size_t i = n-1; i-- > 0;) {
+			y[i] -= upperFactored[i] * y[i+1];
+		}
+	}
+};
+
+static void test_jfnkPreconditioner() {
+	size_t n = 400;
+	double lambda = 1.;
+	for (int usePreconditioner = 0; usePreconditioner < 2; ++usePreconditioner) {
+		int numF = 0;
+		int linearIter = 0;
+		std::vector<double> u(n);
+		Solver::JFNK<double> jfnk(n, u.data(), bratu(n, lambda, numF), 1e-7, 20,
+			[](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+				return std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-9, 10 * n, n);
+			});
+		auto preconditioner = std::make_shared<BratuPreconditioner>(n, lambda);
+		if (usePreconditioner) jfnk.preconditioner = preconditioner;
+		jfnk.stopCallback = [&]() -> bool {
+			linearIter += jfnk.getLinearSolver()->getIter();
+			return false;
+		};
+		jfnk.solve();
+		printf("jfnk %s: newton iter %d residual %e gmres iter %d F evals %d setups %d applies %d u(1/2) %.12f\n",
+			usePreconditioner ? "preconditioned" : "unpreconditioned",
+			jfnk.getIter(), jfnk.getResidual(), linearIter, numF,
+			preconditioner->numSetup, preconditioner->numApply, u[n/2]);
+	}
+
+	//clearing the preconditioner puts back the MInv the linear solver was created with
+	int numF = 0;
+	int createdApplies = 0;
+	std::vector<double> u(n);
+	Solver::JFNK<double> jfnk(n, u.data(), bratu(n, lambda, numF), 1e-7, 20,
+		[&](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+			auto gmres = std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-9, 10 * n, n);
+			gmres->MInv = [&createdApplies, n](double* y, const double* x) {
+				++createdApplies;
+				std::copy(x, x + n, y);
+			};
+			return gmres;
+		});
+	jfnk.preconditioner = std::make_shared<BratuPreconditioner>(n, lambda);
+	jfnk.update();
+	int appliesInstalled = createdApplies;
+	jfnk.preconditioner = nullptr;
+	jfnk.update();
+	printf("jfnk preconditioner cleared: created MInv applied %d times while replaced, restored after %s\n",
+		appliesInstalled, createdApplies > 0 ? "yes" : "no");
+}
+
+/*
+the same problem with F also given batched as multiF: one call per Jacobian-vector product instead of two,
+and jacobianMultiply's k products at once checked against one at a time
+*/
+static void test_jfnkMultiF() {
+	size_t n = 400;
+	double lambda = 1.;
+	int numF = 0;
+	int numMultiF = 0;
+	int numMultiStates = 0;
+	auto F = bratu(n, lambda, numF);
+	std::vector<double> u(n);
+	Solver::JFNK<double> jfnk(n, u.data(), F, 1e-7, 20,
+		[](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+			return std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-9, 10 * n, n);
+		});
+	jfnk.multiF = [&](double* ys, const double* xs, size_t k) {
+		++numMultiF;
+		numMultiStates += (int)k;
+		for (size_t j = 0; j < k; ++j) {
+			F(ys + n * j, xs + n * j);
+		}
+	};
+	jfnk.preconditioner = std::make_shared<BratuPreconditioner>(n, lambda);
+	jfnk.solve();
+	printf("jfnk multiF: newton iter %d residual %e F evals %d multiF calls %d of %d states u(1/2) %.12f\n",
+		jfnk.getIter(), jfnk.getResidual(), numF - numMultiStates, numMultiF, numMultiStates, u[n/2]);
+
+	size_t k = 3;
+	std::vector<double> dxs(n * k), ys(n * k), y(n);
+	for (size_t i = 0; i < n * k; ++i) {
+		dxs[i] = sin(.1 * (double)i);
+	}
+	numMultiF = 0;
+	jfnk.jacobianMultiply(ys.data(), dxs.data(), k);
+	int batchedCalls = numMultiF;
+	double maxDiff = 0;
+	for (size_t j = 0; j < k; ++j) {
+		jfnk.jacobianMultiply(y.data(), dxs.data() + n * j, 1);
+		for (size_t i = 0; i < n; ++i) {
+			maxDiff = fmax(maxDiff, fabs(y[i] - ys[i + n * j]));
+		}
+	}
+	printf("jfnk jacobianMultiply: %d products in %d multiF calls, max difference from one at a time %e\n", (int)k, batchedCalls, maxDiff);
+}
+
+/*
+central against forward differences, JFNK and its GMRES sharing one allocator so its live allocations are the total footprint,
+which getMemoryFootprint() should report.  forward differences put the line search's F in GMRES's r.
+*/
+static void test_jfnkMemory() {
+	size_t n = 400;
+	double lambda = 1.;
+	for (int forwardDifference = 0; forwardDifference < 2; ++forwardDifference) {
+		int numF = 0;
+		std::vector<double> u(n);
+		auto allocator = std::make_shared<Solver::Allocator<double>>();
+		allocator->trackAllocations = true;
+		Solver::JFNK<double> jfnk(n, u.data(), bratu(n, lambda, numF), 1e-7, 20,
+			[&](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+				return std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-9, 10 * n, 20, allocator);
+			}, allocator);
+		jfnk.forwardDifference = forwardDifference;
+		jfnk.preconditioner = std::make_shared<BratuPreconditioner>(n, lambda);
+		jfnk.solve();
+		size_t totalBytes = 0;
+		for (const auto& allocation : allocator->getAllocations()) {
+			totalBytes += allocation.bytes;
+		}
+		printf("jfnk %s: newton iter %d residual %e F evals %d u(1/2) %.12f jfnk bytes %d total bytes %d workspace size %d\n",
+			forwardDifference ? "forward difference" : "central difference",
+			jfnk.getIter(), jfnk.getResidual(), numF, u[n/2],
+			(int)jfnk.getMemoryFootprint(), (int)totalBytes,
+			(int)(sizeof(double) * Solver::JFNK<double>::getWorkspaceSize(n, false, forwardDifference, true)));
+	}
+}
+
+/*
+dense Jacobian newton, chord and Shamanskii on a small Bratu problem,
+and a singular Jacobian that falls back on GMRES after a single dense build
+*/
+static void test_jfnkDense() {
+	size_t n = 16;
+	double lambda = 1.;
+	for (int refresh : {1, 0, 3}) {
+		int numF = 0;
+		std::vector<double> u(n);
+		Solver::JFNK<double> jfnk(n, u.data(), bratu(n, lambda, numF), 1e-10, 50);
+		jfnk.denseJacobianMaxN = n;
+		jfnk.denseJacobianRefresh = refresh;
+		jfnk.solve();
+		printf("jfnk dense refresh %d: newton iter %d residual %e F evals %d jacobian builds %d linear iter %d u(1/2) %.12f\n",
+			refresh, jfnk.getIter(), jfnk.getResidual(), numF, jfnk.getDenseJacobianBuilds(), jfnk.getLinearSolver()->getIter(), u[n/2]);
+	}
+
+	//F = (0, -x2, x1 - 1) has a zero first row
+	int numF = 0;
+	double x[3] = {-1, -1, -1};
+	Solver::JFNK<double> jfnk(3, x, [&](double* y, const double* x) {
+		++numF;
+		y[0] = 0;
+		y[1] = -x[2];
+		y[2] = x[1] - 1;
+	}, 1e-10, 20);
+	jfnk.denseJacobianMaxN = 3;
+	jfnk.solve();
+	printf("jfnk dense singular: newton iter %d residual %e F evals %d jacobian builds %d singular %d x %f %f %f\n",
+		jfnk.getIter(), jfnk.getResidual(), numF, jfnk.getDenseJacobianBuilds(), (int)jfnk.getDenseJacobianSingular(), x[0], x[1], x[2]);
+}
+
+/*
+trust region globalization:
+Bratu with preconditioned GMRES dogleg from a radius smaller than the newton step, so the first steps end on the boundary,
+a well-conditioned symmetric positive-definite cubic with Steihaug ConjGrad, likewise,
+and atan(x), whose full newton step from |x| > 1.4 overshoots, so a large radius has its first steps rejected
+*/
+static void test_jfnkTrustRegion() {
+	auto run = [](const char* name, Solver::JFNK<double>& jfnk, int& numF) {
+		int accepted = 0, rejected = 0, boundary = 0;
+		jfnk.stopCallback = [&]() -> bool {
+			if (jfnk.getAlpha() == 0) ++rejected; else ++accepted;
+			if (jfnk.getLinearSolver()->stopReason == Solver::Krylov<double>::STOP_TRUST_REGION_BOUNDARY) ++boundary;
+			return false;
+		};
+		jfnk.solve();
+		printf("jfnk trust region %s: newton iter %d residual %e F evals %d accepted %d rejected %d boundary %d radius %e\n",
+			name, jfnk.getIter(), jfnk.getResidual(), numF, accepted, rejected, boundary, jfnk.trustRadius);
+	};
+
+	size_t n = 50;
+	double lambda = 1.;
+	{
+		int numF = 0;
+		std::vector<double> u(n);
+		Solver::JFNK<double> jfnk(n, u.data(), bratu(n, lambda, numF), 1e-9, 50,
+			[](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+				return std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-12, 10 * n, n);
+			});
+		jfnk.preconditioner = std::make_shared<BratuPreconditioner>(n, lambda);
+		jfnk.trustRadius = .1;
+		run("preconditioned GMRES dogleg", jfnk, numF);
+	}
+	{
+		//F_i = u_i + u_i^3 / 10 + (u_i-1 + u_i+1) / 5 - 3
+		int numF = 0;
+		std::vector<double> u(n);
+		Solver::JFNK<double> jfnk(n, u.data(), [&](double* y, const double* u) {
+			++numF;
+			for (size_t i = 0; i < n; ++i) {
+				double ul = i > 0 ? u[i-1] : 0.;
+				double ur = i < n-1 ? u[i+1] : 0.;
+				y[i] = u[i] + .1 * u[i] * u[i] * u[i] + .2 * (ul + ur) - 3.;
+			}
+		}, 1e-9, 50,
+			[](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+				return std::make_shared<Solver::ConjGrad<double>>(n, x, b, A, 1e-9, 10 * n);
+			});
+		jfnk.trustRadius = .5;
+		run("ConjGrad Steihaug", jfnk, numF);
+	}
+	{
+		size_t m = 4;
+		int numF = 0;
+		std::vector<double> x = {2., 2.5, -3., 1.5};
+		Solver::JFNK<double> jfnk(m, x.data(), [&](double* y, const double* x) {
+			++numF;
+			for (size_t i = 0; i < m; ++i) {
+				y[i] = atan(x[i]);
+			}
+		}, 1e-9, 50);
+		jfnk.trustRadius = 100;
+		run("atan", jfnk, numF);
+	}
+}
+
+/*
+ASPIN with one-point subdomains on Bratu: G_i(u) = u_i - v_i, where v_i solves F_i = 0 for u_i with its neighbors fixed
+newton runs on G, and the reported residual is still |F| / n
+*/
+static void test_jfnkNonlinearPreconditioner() {
+	size_t n = 100;
+	double lambda = 3.;
+	for (int useG = 0; useG < 2; ++useG) {
+		int numF = 0;
+		int numG = 0;
+		int linearIter = 0;
+		auto F = bratu(n, lambda, numF);
+		std::vector<double> u(n);
+		Solver::JFNK<double> jfnk(n, u.data(), F, 1e-7, 50,
+			[](size_t n, double* x, double* b, Solver::JFNK<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+				return std::make_shared<Solver::GMRES<double>>(n, x, b, A, 1e-10, 10 * n, n);
+			});
+		if (useG) {
+			jfnk.nonlinearPreconditioner = [&](double* y, const double* u) {
+				++numG;
+				double h = 1. / (double)(n + 1);
+				for (size_t i = 0; i < n; ++i) {
+					double neighbors = (i > 0 ? u[i-1] : 0.) + (i < n-1 ? u[i+1] : 0.);
+					double v = u[i];
+					for (int k = 0; k < 20; ++k) {
+						double f = (2. * v - neighbors) / (h * h) - lambda * exp(v);
+						double df = 2. / (h * h) - lambda * exp(v);
+						v -= f / df;
+						if (fabs(f) < 1e-12) break;
+					}
+					y[i] = u[i] - v;
+				}
+			};
+		}
+		jfnk.stopCallback = [&]() -> bool {
+			linearIter += jfnk.getLinearSolver()->getIter();
+			return false;
+		};
+		jfnk.solve();
+		std::vector<double> Fu(n);
+		int numFBefore = numF;
+		F(Fu.data(), u.data());
+		double FNorm = 0;
+		for (size_t i = 0; i < n; ++i) {
+			FNorm += Fu[i] * Fu[i];
+		}
+		printf("jfnk %s: newton iter %d residual %e |F|/n %e gmres iter %d F evals %d G evals %d u(1/2) %.12f\n",
+			useG ? "nonlinear preconditioned" : "plain", jfnk.getIter(), jfnk.getResidual(), sqrt(FNorm) / (double)n,
+			linearIter, numFBefore, numG, u[n/2]);
+	}
+}
+
+void test_nonlinear() {
+	test_jfnkDense();
+	test_jfnkTrustRegion();
+	test_jfnkNonlinearPreconditioner();
+	test_jfnkPreconditioner();
+	test_jfnkMultiF();
+	test_jfnkMemory();
+}
@@ -0,0 +1,274 @@
+#include "Solver/GMRES.h"
+#include "Solver/ConjGrad.h"
+#include "Solver/FieldSplit.h"
+#include "Solver/AdditiveSchwarz.h"
+#include "Solver/SparseApproximateInverse.h"
+#include "Solver/MulticolorGaussSeidel.h"
+#include <vector>
+#include <memory>
+#include <exception>
+#include <stdio.h>
+
+/*
+returns the true residual |b - A x|
+*/
+static double residual(size_t n, Solver::Krylov<double>::Func A, const double* x, const double* b) {
+	std::vector<double> r(n);
+	A(r.data(), x);
+	double err = 0;
+	for (size_t i = 0; i < n; ++i) {
+		err += (r[i] - b[i]) * (r[i] - b[i]);
+	}
+	return sqrt(err);
+}
+
+/*
+two interleaved fields on a 1D grid, u at even indexes and v at odd indexes:
+	-u'' + u + c v = b_u
+	-v'' / 100 + v + c u = b_v
+*/
+static void test_fieldSplit() {
+	size_t m = 100;
+	size_t n = 2 * m;
+	double c = .5;
+	std::vector<double> b(n, 1);
+	std::vector<double> x(n);
+
+	Solver::Krylov<double>::Func A = [&](double* y, const double* x) {
+		for (int i = 0; i < (int)m; ++i) {
+			for (int f = 0; f < 2; ++f) {
+				double scale = f == 0 ? 1 : .01;
+				double l = i > 0 ? x[2*(i-1)+f] : 0;
+				double r = i < (int)m-1 ? x[2*(i+1)+f] : 0;
+				y[2*i+f] = scale * (2. * x[2*i+f] - l - r) + x[2*i+f] + c * x[2*i+1-f];
+			}
+		}
+	};
+
+	std::vector<size_t> uIndexes, vIndexes;
+	for (size_t i = 0; i < m; ++i) {
+		uIndexes.push_back(2*i);
+		vIndexes.push_back(2*i+1);
+	}
+	auto createBlockSolver = [](size_t n, double* x, double* b, Solver::Krylov<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+		return std::make_shared<Solver::ConjGrad<double>>(n, x, b, A, 1e-12, n);
+	};
+
+	const char* names[] = {"none", "additive", "multiplicative", "schur"};
+	for (int type = -1; type <= (int)Solver::FieldSplit<double>::SCHUR; ++type) {
+		std::fill(x.begin(), x.end(), 0);
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 20);
+		std::shared_ptr<Solver::FieldSplit<double>> fieldSplit;
+		if (type >= 0) {
+			fieldSplit = std::make_shared<Solver::FieldSplit<double>>(n, A, (Solver::FieldSplit<double>::type_t)type);
+			fieldSplit->addField(uIndexes, createBlockSolver);
+			fieldSplit->addField(vIndexes, createBlockSolver);
+			gmres.MInv = fieldSplit->getMInv();
+		}
+		gmres.solve();
+		printf("field split %s: gmres iter %d residual %e\n", names[type+1], gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+}
+
+/*
+2D Dirichlet Laplacian on a size x size grid
+*/
+static Solver::Krylov<double>::Func makeLaplacian(size_t size) {
+	return [size](double* y, const double* x) {
+		int s = (int)size;
+		for (int j = 0; j < s; ++j) {
+			for (int i = 0; i < s; ++i) {
+				double sum = 4. * x[i + s * j];
+				if (i > 0) sum -= x[i-1 + s * j];
+				if (i < s-1) sum -= x[i+1 + s * j];
+				if (j > 0) sum -= x[i + s * (j-1)];
+				if (j < s-1) sum -= x[i + s * (j+1)];
+				y[i + s * j] = sum;
+			}
+		}
+	};
+}
+
+/*
+2D convection-diffusion on a size x size grid as a CSR matrix
+-laplacian(u) + convection * du/dx, upwinded
+convection = 0 gives the symmetric Dirichlet Laplacian
+*/
+static Solver::CSR<double> makeConvectionDiffusionCSR(size_t size, double convection) {
+	int s = (int)size;
+	std::vector<Solver::CSR<double>::Triplet> triplets;
+	for (int j = 0; j < s; ++j) {
+		for (int i = 0; i < s; ++i) {
+			int k = i + s * j;
+			triplets.push_back({k, k, 4. + convection});
+			if (i > 0) triplets.push_back({k, k-1, -1. - convection});
+			if (i < s-1) triplets.push_back({k, k+1, -1.});
+			if (j > 0) triplets.push_back({k, k-s, -1.});
+			if (j < s-1) triplets.push_back({k, k+s, -1.});
+		}
+	}
+	return Solver::CSR<double>::fromTriplets(size * size, size * size, triplets);
+}
+
+static void test_additiveSchwarz() {
+	size_t size = 32;
+	size_t n = size * size;
+	auto A = makeLaplacian(size);
+	std::vector<double> b(n, 1);
+	std::vector<double> x(n);
+
+	auto createLocalSolver = [](size_t n, double* x, double* b, Solver::Krylov<double>::Func A) -> std::shared_ptr<Solver::Krylov<double>> {
+		return std::make_shared<Solver::ConjGrad<double>>(n, x, b, A, 1e-12, n);
+	};
+
+	struct {
+		const char* name;
+		bool restricted;
+		bool coarse;
+		bool krylov;
+	} configs[] = {
+		{"AS dense", false, false, false},
+		{"RAS dense", true, false, false},
+		{"RAS dense + coarse", true, true, false},
+		{"RAS krylov + coarse", true, true, true},
+	};
+	{
+		std::fill(x.begin(), x.end(), 0);
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 30);
+		gmres.solve();
+		printf("schwarz none: gmres iter %d residual %e\n", gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+	for (auto& config : configs) {
+		std::fill(x.begin(), x.end(), 0);
+		Solver::AdditiveSchwarz<double> schwarz(n, A, config.restricted);
+		schwarz.useCoarseSpace = config.coarse;
+		//overlap by 2 grid rows
+		schwarz.addContiguousSubdomains(8, 2 * size, config.krylov ? createLocalSolver : Solver::AdditiveSchwarz<double>::CreateSolver());
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 30);
+		gmres.MInv = schwarz.getMInv();
+		gmres.solve();
+		printf("schwarz %s: gmres iter %d residual %e\n", config.name, gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+	{
+		//the same Laplacian with its local blocks read from the CSR rows instead of probed
+		std::fill(x.begin(), x.end(), 0);
+		Solver::CSR<double> laplacian = makeConvectionDiffusionCSR(size, 0);
+		Solver::AdditiveSchwarz<double> schwarz(laplacian);
+		schwarz.addContiguousSubdomains(8, 2 * size);
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 30);
+		gmres.MInv = schwarz.getMInv();
+		gmres.solve();
+		printf("schwarz RAS dense from CSR: gmres iter %d residual %e\n", gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+}
+
+static void test_sparseApproximateInverse() {
+	size_t size = 32;
+	size_t n = size * size;
+	std::vector<double> b(n, 1);
+	std::vector<double> x(n);
+
+	Solver::CSR<double> laplacian = makeConvectionDiffusionCSR(size, 0);
+	auto A = laplacian.getFunc();
+	for (int precond = 0; precond < 2; ++precond) {
+		std::fill(x.begin(), x.end(), 0);
+		Solver::ConjGrad<double> cg(n, x.data(), b.data(), A, 1e-10, 10 * n);
+		std::shared_ptr<Solver::FSAI<double>> fsai;
+		if (precond) {
+			fsai = std::make_shared<Solver::FSAI<double>>(laplacian);
+			cg.MInv = fsai->getMInv();
+		}
+		cg.solve();
+		printf("%s: cg iter %d residual %e\n", precond ? "FSAI" : "no preconditioner", cg.getIter(), residual(n, A, x.data(), b.data()));
+	}
+
+	Solver::CSR<double> convectionDiffusion = makeConvectionDiffusionCSR(size, 5);
+	A = convectionDiffusion.getFunc();
+	for (int precond = 0; precond < 2; ++precond) {
+		std::fill(x.begin(), x.end(), 0);
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-10, 10 * n, 30);
+		std::shared_ptr<Solver::SPAI<double>> spai;
+		if (precond) {
+			spai = std::make_shared<Solver::SPAI<double>>(convectionDiffusion);
+			gmres.MInv = spai->getMInv();
+		}
+		gmres.solve();
+		printf("%s: gmres iter %d residual %e\n", precond ? "SPAI" : "no preconditioner", gmres.getIter(), residual(n, A, x.data(), b.data()));
+	}
+
+	//FSAI on a matrix missing a diagonal entry must fail rather than silently zero that unknown
+	std::vector<Solver::CSR<double>::Triplet> triplets;
+	for (int k = 0; k < (int)n; ++k) {
+		if (k != 5) triplets.push_back({k, k, 4.});
+		if (k > 0) triplets.push_back({k, k-1, -1.});
+		if (k < (int)n-1) triplets.push_back({k, k+1, -1.});
+	}
+	bool thrown = false;
+	try {
+		Solver::FSAI<double> fsai(Solver::CSR<double>::fromTriplets(n, n, triplets));
+	} catch (const std::exception&) {
+		thrown = true;
+	}
+	printf("FSAI without a stored diagonal: thrown %s\n", thrown ? "yes" : "no");
+}
+
+/*
+GMRES restart residuals from the Arnoldi relation, with and without a periodic true residual,
+against the true residual at every restart (interval 1) as the baseline
+*/
+static void test_trueResidualInterval() {
+	size_t size = 32;
+	size_t n = size * size;
+	std::vector<double> b(n, 1);
+	std::vector<double> x(n);
+
+	Solver::CSR<double> convectionDiffusion = makeConvectionDiffusionCSR(size, 5);
+	auto A = convectionDiffusion.getFunc();
+	for (int interval : {1, 4, 0}) {
+		std::fill(x.begin(), x.end(), 0);
+		int numA = 0;
+		Solver::GMRES<double> gmres(n, x.data(), b.data(), [&](double* y, const double* x) {
+			++numA;
+			A(y, x);
+		}, 1e-10, 10 * n, 30);
+		gmres.trueResidualInterval = interval;
+		gmres.solve();
+		printf("true residual every %d restarts: gmres iter %d, A applications %d, residual %e\n", interval, gmres.getIter(), numA, residual(n, A, x.data(), b.data()));
+	}
+}
+
+static void test_multicolorGaussSeidel() {
+	size_t size = 32;
+	size_t n = size * size;
+	std::vector<double> b(n, 1);
+	std::vector<double> x(n);
+
+	Solver::CSR<double> laplacian = makeConvectionDiffusionCSR(size, 0);
+	auto A = laplacian.getFunc();
+
+	Solver::MulticolorGaussSeidel<double> greedy(laplacian);
+	Solver::MulticolorGaussSeidel<double> redBlack(laplacian, Solver::MulticolorGaussSeidel<double>::colorGrid({size, size}, false));
+	printf("greedy coloring colors: %d, red-black colors: %d\n", (int)greedy.getNumColors(), (int)redBlack.getNumColors());
+
+	//as a smoother
+	redBlack.omega = 1.5;
+	redBlack.smooth(x.data(), b.data(), 20);
+	printf("20 red-black SOR sweeps: residual %e\n", residual(n, A, x.data(), b.data()));
+
+	//as a symmetric preconditioner
+	std::fill(x.begin(), x.end(), 0);
+	redBlack.symmetric = true;
+	redBlack.omega = 1;
+	Solver::ConjGrad<double> cg(n, x.data(), b.data(), A, 1e-10, 10 * n);
+	cg.MInv = redBlack.getMInv();
+	cg.solve();
+	printf("red-black SSOR: cg iter %d residual %e\n", cg.getIter(), residual(n, A, x.data(), b.data()));
+}
+
+void test_preconditioners() {
+	test_fieldSplit();
+	test_additiveSchwarz();
+	test_sparseApproximateInverse();
+	test_trueResidualInterval();
+	test_multicolorGaussSeidel();
+}
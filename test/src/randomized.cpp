@@ -0,0 +1,190 @@
+#include "Solver/GMRES.h"
+#include "Solver/SketchedGMRES.h"
+#include "Solver/RandomizedLeastSquares.h"
+#include "Solver/RandomizedSVD.h"
+#include "Solver/DenseInverse.h"
+#include <vector>
+#include <random>
+#include <math.h>
+#include <stdio.h>
+
+//2D convection-diffusion on a size x size grid, Dirichlet boundaries, upwinded convection c in x
+static std::function<void(double*, const double*)> convectionDiffusion(int size, double c) {
+	return [=](double* y, const double* x) {
+		for (int j = 0; j < size; ++j) {
+			for (int i = 0; i < size; ++i) {
+				int k = i + size * j;
+				double sum = (4. + c) * x[k];
+				if (i > 0) sum -= (1. + c) * x[k-1];
+				if (i < size-1) sum -= x[k+1];
+				if (j > 0) sum -= x[k-size];
+				if (j < size-1) sum -= x[k+size];
+				y[k] = sum;
+			}
+		}
+	};
+}
+
+static double residual(int n, std::function<void(double*, const double*)> A, const double* x, const double* b) {
+	std::vector<double> Ax(n);
+	A(Ax.data(), x);
+	double sum = 0;
+	for (int i = 0; i < n; ++i) {
+		sum += (b[i] - Ax[i]) * (b[i] - Ax[i]);
+	}
+	return sqrt(sum);
+}
+
+static void test_sketchedGMRES() {
+	int size = 64;
+	int n = size * size;
+	auto A = convectionDiffusion(size, 2.);
+	std::vector<double> b(n);
+	for (int i = 0; i < n; ++i) {
+		b[i] = sin(.01 * i) + 1.;
+	}
+	int restart = 80;
+
+	std::vector<double> x(n);
+	Solver::GMRES<double> gmres(n, x.data(), b.data(), A, 1e-8, 10 * n, restart);
+	gmres.solve();
+	printf("gmres: iter %d residual %e\n", gmres.getIter(), residual(n, A, x.data(), b.data()));
+
+	std::fill(x.begin(), x.end(), 0.);
+	Solver::SketchedGMRES<double> sgmres(n, x.data(), b.data(), A, 1e-8, 10 * n, restart);
+	sgmres.solve();
+	printf("sketched gmres: iter %d residual %e\n", sgmres.getIter(), residual(n, A, x.data(), b.data()));
+}
+
+/*
+tall least squares with graded column scales, condition number ~1e6
+compares sketch-and-precondition LSQR against the dense Householder QR solve
+*/
+static void test_randomizedLeastSquares() {
+	size_t m = 2000;
+	size_t n = 50;
+	std::mt19937 rng(2);
+	std::normal_distribution<double> normal;
+	std::vector<double> a(m * n);
+	for (size_t j = 0; j < n; ++j) {
+		double scale = pow(10., -6. * j / (n - 1));
+		for (size_t i = 0; i < m; ++i) {
+			a[i + m * j] = normal(rng) * scale;
+		}
+	}
+	std::vector<double> b(m);
+	for (auto& bi : b) {
+		bi = normal(rng);
+	}
+
+	std::vector<double> xQR(n);
+	Solver::HouseholderQR<double>().solveLinear_leastSquares(m, n, xQR.data(), a.data(), b.data());
+
+	std::vector<double> x(n);
+	Solver::RandomizedLeastSquares<double> lsq(m, n, a.data(), 1e-14);
+	lsq.solve(x.data(), b.data());
+
+	auto normalEquationsResidual = [&](const std::vector<double>& x) {
+		//|a^T (b - a x)| / (|a| |b - a x|), with |a| the Frobenius norm
+		std::vector<double> r(b);
+		double aNormSq = 0;
+		for (size_t j = 0; j < n; ++j) {
+			for (size_t i = 0; i < m; ++i) {
+				r[i] -= a[i + m * j] * x[j];
+				aNormSq += a[i + m * j] * a[i + m * j];
+			}
+		}
+		double atr = 0;
+		for (size_t j = 0; j < n; ++j) {
+			double sum = 0;
+			for (size_t i = 0; i < m; ++i) {
+				sum += a[i + m * j] * r[i];
+			}
+			atr += sum * sum;
+		}
+		return sqrt(atr) / (sqrt(aNormSq) * Solver::Vector<double>::normL2(m, r.data()));
+	};
+	double diff = 0, xNorm = 0;
+	for (size_t j = 0; j < n; ++j) {
+		diff += (x[j] - xQR[j]) * (x[j] - xQR[j]);
+		xNorm += xQR[j] * xQR[j];
+	}
+	printf("householder QR: optimality %e\n", normalEquationsResidual(xQR));
+	printf("randomized least squares: lsqr iter %d, optimality %e, relative difference to QR %e\n", lsq.getIter(), normalEquationsResidual(x), sqrt(diff / xNorm));
+}
+
+/*
+dense m x n operator with singular values 1 / (1 + j), slow enough decay that power iterations matter
+prints the rank-k Frobenius error against the optimal sqrt(sum_{j >= k} sigma_j^2)
+*/
+static void test_randomizedSVD() {
+	size_t m = 500;
+	size_t n = 300;
+	size_t rank = 10;
+	std::mt19937 rng(3);
+	std::normal_distribution<double> normal;
+
+	//a = u0 diag(sigma) v0^T with random orthonormal u0, v0
+	std::vector<double> u0(m * n), v0(n * n), sigma(n);
+	for (auto& x : u0) x = normal(rng);
+	for (auto& x : v0) x = normal(rng);
+	Solver::HouseholderQR<double>().orthonormalize(m, n, u0.data());
+	Solver::HouseholderQR<double>().orthonormalize(n, n, v0.data());
+	std::vector<double> a(m * n);
+	for (size_t k = 0; k < n; ++k) {
+		sigma[k] = 1. / (1. + k);
+		for (size_t j = 0; j < n; ++j) {
+			double vjk = v0[j + n * k] * sigma[k];
+			for (size_t i = 0; i < m; ++i) {
+				a[i + m * j] += u0[i + m * k] * vjk;
+			}
+		}
+	}
+	auto A = [&](double* y, const double* x) {
+		for (size_t i = 0; i < m; ++i) y[i] = 0;
+		for (size_t j = 0; j < n; ++j) {
+			for (size_t i = 0; i < m; ++i) {
+				y[i] += a[i + m * j] * x[j];
+			}
+		}
+	};
+	auto AH = [&](double* y, const double* x) {
+		for (size_t j = 0; j < n; ++j) {
+			y[j] = Solver::Vector<double>::dot(m, a.data() + m * j, x);
+		}
+	};
+
+	double optimal = 0;
+	for (size_t k = rank; k < n; ++k) {
+		optimal += sigma[k] * sigma[k];
+	}
+	printf("randomized svd: rank %d optimal error %e\n", (int)rank, sqrt(optimal));
+
+	for (int powerIterations = 0; powerIterations <= 2; ++powerIterations) {
+		Solver::RandomizedSVD<double> rsvd(m, n, A, AH, rank, 10, powerIterations);
+		std::vector<double> u(m * rank), s(rank), v(n * rank);
+		rsvd.svd(u.data(), s.data(), v.data());
+
+		double error = 0;
+		for (size_t j = 0; j < n; ++j) {
+			for (size_t i = 0; i < m; ++i) {
+				double x = a[i + m * j];
+				for (size_t k = 0; k < rank; ++k) {
+					x -= u[i + m * k] * s[k] * v[j + n * k];
+				}
+				error += x * x;
+			}
+		}
+		double sigmaError = 0;
+		for (size_t k = 0; k < rank; ++k) {
+			sigmaError = fmax(sigmaError, fabs(s[k] - sigma[k]) / sigma[k]);
+		}
+		printf("randomized svd: power iterations %d error %e max relative singular value error %e\n", powerIterations, sqrt(error), sigmaError);
+	}
+}
+
+void test_randomized() {
+	test_sketchedGMRES();
+	test_randomizedLeastSquares();
+	test_randomizedSVD();
+}
@@ -0,0 +1,70 @@
+#include "Solver/Permutation.h"
+#include "Solver/ConjGrad.h"
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <stdio.h>
+
+static int bandwidth(const Solver::CSR<double>& A) {
+	Solver::Index b = 0;
+	for (Solver::Index i = 0; i < (Solver::Index)A.rows; ++i) {
+		for (Solver::Index k = A.rowOffsets[i]; k < A.rowOffsets[i+1]; ++k) {
+			b = std::max(b, std::abs(A.colIndexes[k] - i));
+		}
+	}
+	return (int)b;
+}
+
+//2D Dirichlet Laplacian with its unknowns randomly shuffled, as an unstructured mesh would be
+void test_reordering() {
+	int size = 40;
+	int n = size * size;
+	std::vector<Solver::CSR<double>::Triplet> triplets;
+	for (int j = 0; j < size; ++j) {
+		for (int i = 0; i < size; ++i) {
+			int k = i + size * j;
+			triplets.push_back({k, k, 4.});
+			if (i > 0) triplets.push_back({k, k-1, -1.});
+			if (i < size-1) triplets.push_back({k, k+1, -1.});
+			if (j > 0) triplets.push_back({k, k-size, -1.});
+			if (j < size-1) triplets.push_back({k, k+size, -1.});
+		}
+	}
+	std::vector<Solver::Index> shuffle(n);
+	for (int i = 0; i < n; ++i) shuffle[i] = i;
+	std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937(1));
+	Solver::CSR<double> A = Solver::Permutation<double>(shuffle).apply(Solver::CSR<double>::fromTriplets(n, n, triplets));
+	printf("shuffled bandwidth %d\n", bandwidth(A));
+
+	Solver::Permutation<double> rcm = Solver::Permutation<double>::reverseCuthillMcKee(A);
+	printf("reverse Cuthill-McKee bandwidth %d\n", bandwidth(rcm.apply(A)));
+
+	Solver::Permutation<double> nd = Solver::Permutation<double>::nestedDissection(A, 16);
+	std::vector<Solver::Index> sorted = nd.perm;
+	std::sort(sorted.begin(), sorted.end());
+	bool isPermutation = true;
+	for (int i = 0; i < n; ++i) {
+		if (sorted[i] != i) isPermutation = false;
+	}
+	printf("nested dissection is a permutation: %s\n", isPermutation ? "yes" : "no");
+
+	std::vector<double> x(n), b(n, 1);
+	int iter = 0;
+	rcm.solve(A, x.data(), b.data(), [&](size_t n, double* x, double* b, const Solver::CSR<double>& PA) -> std::shared_ptr<Solver::Krylov<double>> {
+		auto cg = std::make_shared<Solver::ConjGrad<double>>(n, x, b, PA.getFunc(), 1e-10, 10 * n);
+		cg->stopCallback = [&, cg = cg.get()]() -> bool {
+			iter = cg->getIter();
+			return false;
+		};
+		return cg;
+	});
+	std::vector<double> r(n);
+	A.mul(r.data(), x.data());
+	double err = 0;
+	for (int i = 0; i < n; ++i) {
+		err += (r[i] - b[i]) * (r[i] - b[i]);
+	}
+	printf("cg in RCM order: iter %d residual %e\n", iter, sqrt(err));
+}
@@ -1,7 +1,12 @@
 #include "Solver/GMRES.h"
+#include "Solver/TFQMR.h"
 #include "Solver/DenseInverse.h"
 #include "Solver/JFNK.h"
+#include "Solver/WorkspaceAllocator.h"
+#include <vector>
+#include <algorithm>
 #include <iostream>
+#include <cmath>
 
 void test_smallDense() {
 	size_t n = 3;
@@ -17,6 +22,23 @@ void test_smallDense() {
 	std::cout << "QR:" << std::endl;
 	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
 
+	//symmetric positive-definite, so all three factorizations apply
+	double spd[3*3] = {
+		4,1,0,
+		1,3,1,
+		0,1,2
+	};
+	double spdb[3] = {1,2,3};
+	Solver::HouseholderQR<double>().solveLinear(n, x, spd, spdb);
+	std::cout << "QR SPD:" << std::endl;
+	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+	Solver::LU<double>().solveLinear(n, x, spd, spdb);
+	std::cout << "LU SPD:" << std::endl;
+	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+	Solver::Cholesky<double>().solveLinear(n, x, spd, spdb);
+	std::cout << "Cholesky SPD:" << std::endl;
+	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+
 	x[0] = -1;
 	x[1] = -1;
 	x[2] = -1;
@@ -32,6 +54,38 @@ void test_smallDense() {
 	std::cout << "GMRES:" << std::endl;
 	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
 
+	x[0] = -1;
+	x[1] = -1;
+	x[2] = -1;
+	Solver::TFQMR<double>(n, x, b, [&](double *y, const double* x) {
+		for (int i = 0; i < (int)n; ++i) {
+			double sum = 0;
+			for (int j = 0; j < (int)n; ++j) {
+				sum = sum + a[i+n*j] * x[j];
+			}
+			y[i] = sum;
+		}
+	}, 1e-7, 20).solve();
+	std::cout << "TFQMR:" << std::endl;
+	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+
+	//TFQMR on the 1D Dirichlet Laplacian, whose solution for b = -2 is x_i = (i+1) (m-i)
+	{
+		size_t m = 32;
+		std::vector<double> lx(m), lb(m, -2.);
+		Solver::TFQMR<double> tfqmr(m, lx.data(), lb.data(), [&](double* y, const double* x) {
+			for (int i = 0; i < (int)m; ++i) {
+				y[i] = (i > 0 ? x[i-1] : 0.) - 2. * x[i] + (i < (int)m-1 ? x[i+1] : 0.);
+			}
+		}, 1e-10, 10*m);
+		tfqmr.solve();
+		double maxError = 0;
+		for (int i = 0; i < (int)m; ++i) {
+			maxError = std::max(maxError, fabs(lx[i] - (double)((i+1) * ((int)m-i))));
+		}
+		std::cout << "TFQMR Laplacian: " << tfqmr.getIter() << " iterations, stop reason " << tfqmr.stopReason << ", max error " << (maxError < 1e-6 ? "< 1e-6" : "too large") << std::endl;
+	}
+
 	x[0] = -1;
 	x[1] = -1;
 	x[2] = -1;
@@ -66,5 +120,26 @@ void test_smallDense() {
 	
 	std::cout << "JFNK:" << std::endl;
 	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+
+	//JFNK and its GMRES working entirely in caller-provided memory
+	x[0] = -1;
+	x[1] = -1;
+	x[2] = -1;
+	std::vector<double> workspace(
+		Solver::JFNK<double>::getWorkspaceSize(n, true)
+		+ Solver::GMRES<double>::getWorkspaceSize(n, n));
+	auto workspaceAllocator = std::make_shared<Solver::WorkspaceAllocator<double>>(workspace.data(), workspace.size());
+	Solver::JFNK<double> jfnkWorkspace(n, x, [&](double* y, const double* x) {
+		y[0] = 0;
+		y[1] = -x[2];
+		y[2] = x[1] - 1;
+	}, 1e-10, 100, [&](size_t n, double* x, double* b, Solver::JFNK<double>::Func linearFunc) -> std::shared_ptr<Solver::Krylov<double>> {
+		return std::make_shared<Solver::GMRES<double>>(n, x, b, linearFunc, 1e-20, 10*n, n, workspaceAllocator);
+	}, workspaceAllocator);
+	jfnkWorkspace.lineSearchMaxIter = 100;
+	jfnkWorkspace.solve();
+	std::cout << "JFNK in workspace:" << std::endl;
+	std::cout << x[0] << ", " << x[1] << ", " << x[2] << std::endl;
+	std::cout << "workspace used " << workspaceAllocator->getUsed() << " of " << workspaceAllocator->getSize() << std::endl;
 }
 
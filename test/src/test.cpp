@@ -2,12 +2,39 @@
 
 void test_discreteLaplacian();
 void test_smallDense();
+void test_preconditioners();
+void test_reordering();
+void test_extendedPrecision();
+void test_complex();
+void test_multiShift();
+void test_randomized();
+void test_nonlinear();
+void test_allocator();
+void test_expr();
 
 int main(int argc, char** argv) {
 	std::string test = "discreteLaplacian";
 	if (argc > 1) test = argv[1];
 	if (test == "smallDense") {
 		test_smallDense();
+	} else if (test == "preconditioners") {
+		test_preconditioners();
+	} else if (test == "reordering") {
+		test_reordering();
+	} else if (test == "extendedPrecision") {
+		test_extendedPrecision();
+	} else if (test == "complex") {
+		test_complex();
+	} else if (test == "multiShift") {
+		test_multiShift();
+	} else if (test == "randomized") {
+		test_randomized();
+	} else if (test == "nonlinear") {
+		test_nonlinear();
+	} else if (test == "allocator") {
+		test_allocator();
+	} else if (test == "expr") {
+		test_expr();
 	} else {
 		test_discreteLaplacian();
 	}